@@ -22,6 +22,7 @@ class AppDelegate: UIResponder, UIApplicationDelegate
         didFinishLaunchingWithOptions launchOptions: [UIApplication.LaunchOptionsKey: Any]?) -> Bool
     {
         window = UIWindow.buildWindow()
+        MainViewModel.startPrefetchingPuzzles()
         let rootVC = MainViewController(nibName: nil, bundle: nil)
         let viewModel = loadViewModel()
         rootVC.viewModel = viewModel
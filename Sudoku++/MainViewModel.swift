@@ -155,6 +155,13 @@ public class MainViewModel: Archivable
     fileprivate let undoManager = UndoManager()
     fileprivate var invalidCells: [SudokuBoardIndex]
     
+    // Puzzles.bank, written by Tools/PuzzleBank, spares generating puzzles while the player waits. Without it, or
+    // for a difficulty it has no puzzles of, they are generated as before.
+    fileprivate static let puzzleBank = Bundle.main.url(forResource: "Puzzles", withExtension: "bank").flatMap {
+        PuzzleBank(contentsOf: $0)
+    }
+    fileprivate static var puzzlePool: PuzzlePool?
+    
     var newGameDifficulties: [DisplayablePuzzleDifficulty] = {
         var difficulties = [DisplayablePuzzleDifficulty]()
         for count in PuzzleDifficulty.blank.rawValue ..< Int.max {
@@ -178,6 +185,13 @@ public class MainViewModel: Archivable
         invalidCells = []
     }
     
+    // Starts generating puzzles in the background for new games to take, unless they come from Puzzles.bank.
+    // Call from the main thread.
+    class func startPrefetchingPuzzles()
+    {
+        if puzzleBank == nil && puzzlePool == nil { puzzlePool = PuzzlePool(order: 3, capacity: 2) }
+    }
+    
     public required init?(fromArchive archive: NSDictionary)
     {
         if let sudokuBoard = archive["sudokuBoard"] as? SudokuBoard,
@@ -230,7 +244,10 @@ public class MainViewModel: Archivable
         stopTimer()
         counter = 0
         sendNewTimerText()
-        if let board = SudokuBoard.generatePuzzle(ofOrder: 3, difficulty: titleToDifficulty(title)) {
+        let difficulty = titleToDifficulty(title)
+        if let board = MainViewModel.puzzleBank?.puzzle(ofOrder: 3, difficulty: difficulty) ??
+            MainViewModel.puzzlePool?.puzzle(difficulty: difficulty) ??
+            SudokuBoard.generatePuzzle(ofOrder: 3, difficulty: difficulty) {
             self.sudokuBoard = board
         }
         else if let board = SudokuBoard.generatePuzzle(ofOrder: 3, difficulty: .blank) {
@@ -274,7 +291,9 @@ public class MainViewModel: Archivable
             switch difficulty {
             case .noSolution:           reason = "No solution available for puzzle."
             case .multipleSolutions:    reason = "Multiple solutions available for puzzle."
-            default:                    reason = "An unknown error occured"
+            default:
+                reason = sudokuBoard.solveStatus == .overBudget ? "Puzzle took too long to solve." :
+                    "An unknown error occured"
             }
             delegate?.setPuzzleStateChanged(.canSet)
             delegate?.setPuzzleStateChanged(.failed(reason))
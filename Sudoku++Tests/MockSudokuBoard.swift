@@ -21,6 +21,7 @@ class MockSudokuBoard: NSObject, Mock, SudokuBoardProtocol
         case difficultyScore
         case isSolved
         case isValid
+        case solveStatus
         case solutionDescription
         case solve
         case markupBoard
@@ -37,6 +38,7 @@ class MockSudokuBoard: NSObject, Mock, SudokuBoardProtocol
     var difficultyScore: Int { return registerInvocation(.difficultyScore, returning: 0) }
     var isValid: Bool { return registerInvocation(.isValid, returning: true) }
     var isSolved: Bool { return registerInvocation(.isSolved, returning: false) }
+    var solveStatus: SolveStatus? { return registerInvocation(.solveStatus, returning: { (_: Any?...) in nil } ) }
     
     func solve() -> Bool { return registerInvocation(.solve, returning: true) }
     func markupBoard() { registerInvocation(.markupBoard) }
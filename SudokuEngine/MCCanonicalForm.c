@@ -0,0 +1,304 @@
+//
+//  MCCanonicalForm.c
+//  Sudoku++
+//
+//  Created by Maarut Chandegra on 17/10/2026.
+//  Copyright © 2026 Maarut Chandegra. All rights reserved.
+//
+
+#include "MCCanonicalForm.h"
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#pragma mark Typedefs
+
+// A symmetry the search is following, stored as stateSize consecutive numbers. Rows and columns are filled in as the
+// search reaches them, and numbers are labelled in the order they are first seen, which is always the best labelling
+// for the rows and columns chosen.
+#define MCStateTransposed   0
+#define MCStateNextLabel    1
+#define MCStateRows         2
+#define MCStateColumns(dimensionality)  (MCStateRows + (dimensionality))
+#define MCStateLabels(dimensionality)   (MCStateRows + (dimensionality) * 2)
+
+#define MCPuzzleSetMinCapacity 1024
+
+typedef struct _MCCanonicalSearch {
+    uint order;
+    uint dimensionality;
+    const uint *grid;
+    uint stateSize;
+    uint maxStates;         // MCCanonicalMaxStates(dimensionality)
+    uint *states;           // states[stateCount * stateSize]
+    uint stateCount;
+    uint stateCapacity;
+    uint *nextStates;       // The states tied for the cell being searched.
+    uint nextCount;
+    uint nextCapacity;
+    uint *rowChoices;       // rowChoices[dimensionality]
+    uint *columnChoices;    // columnChoices[dimensionality]
+    int hasTooManyStates;   // More than maxStates were tied for the last cell searched.
+} MCCanonicalSearch;
+
+struct _MCPuzzleSet {
+    uint order;
+    uint cellCount;
+    uint count;
+    uint capacity;          // Always a power of 2, at least twice count.
+    uint64_t *hashes;       // hashes[capacity]
+    uint *slots;            // slots[capacity], 1 more than the index of the puzzle in the slot, or 0 if it's empty.
+    unsigned char *puzzles; // puzzles[puzzleCapacity * cellCount], the canonical forms in the order they were added
+    uint puzzleCapacity;
+    uint *canonical;        // canonical[cellCount]
+};
+
+#pragma mark Choosing Rows and Columns
+
+// Writes the lines of the original that could become line index of the result, given lines[0..index - 1], and
+// returns how many there are. Lines stay within their band, and bands are taken whole.
+static uint findLineChoices(uint order, const uint *lines, uint index, uint *choices)
+{
+    uint count = 0;
+    if (index % order != 0) {
+        uint band = lines[index - 1] / order;
+        for (uint line = band * order; line < band * order + order; line++) {
+            int isUsed = 0;
+            for (uint i = index - index % order; i < index && !isUsed; i++) { isUsed = lines[i] == line; }
+            if (!isUsed) { choices[count++] = line; }
+        }
+        return count;
+    }
+    for (uint band = 0; band < order; band++) {
+        int isUsed = 0;
+        for (uint i = 0; i < index && !isUsed; i += order) { isUsed = lines[i] / order == band; }
+        for (uint line = band * order; line < band * order + order && !isUsed; line++) { choices[count++] = line; }
+    }
+    return count;
+}
+
+#pragma mark Searching
+
+static uint labelForCell(const MCCanonicalSearch *search, const uint *state, uint row, uint column)
+{
+    uint dimensionality = search->dimensionality;
+    uint number = state[MCStateTransposed] ?
+        search->grid[column * dimensionality + row] : search->grid[row * dimensionality + column];
+    if (number == 0) { return 0; }
+    uint label = state[MCStateLabels(dimensionality) + number];
+    return label != 0 ? label : state[MCStateNextLabel];
+}
+
+static void pushState(MCCanonicalSearch *search, const uint *state, uint row, uint column, uint sourceRow,
+    uint sourceColumn)
+{
+    if (search->nextCount == search->nextCapacity) {
+        search->nextCapacity *= 2;
+        search->nextStates = realloc(search->nextStates, sizeof(uint) * search->nextCapacity * search->stateSize);
+    }
+    uint dimensionality = search->dimensionality;
+    uint *next = search->nextStates + search->nextCount++ * search->stateSize;
+    memcpy(next, state, sizeof(uint) * search->stateSize);
+    next[MCStateRows + row] = sourceRow;
+    next[MCStateColumns(dimensionality) + column] = sourceColumn;
+    uint cell = next[MCStateTransposed] ?
+        sourceColumn * dimensionality + sourceRow : sourceRow * dimensionality + sourceColumn;
+    uint number = search->grid[cell];
+    if (number != 0 && next[MCStateLabels(dimensionality) + number] == 0) {
+        next[MCStateLabels(dimensionality) + number] = next[MCStateNextLabel]++;
+    }
+}
+
+// Tries every way each state could fill cell (row, column), keeping only those that give it the smallest number, and
+// returns that number. New rows are only chosen at the start of a row and new columns only along the first row, so
+// most cells just weed out states. A smaller number can still turn up after the states tied so far have filled
+// maxStates, so the search only gives up if none does.
+static uint searchCell(MCCanonicalSearch *search, uint row, uint column)
+{
+    uint dimensionality = search->dimensionality, best = UINT_MAX;
+    search->nextCount = 0;
+    search->hasTooManyStates = 0;
+    for (uint i = 0; i < search->stateCount; i++) {
+        const uint *state = search->states + i * search->stateSize;
+        const uint *rows = state + MCStateRows, *columns = state + MCStateColumns(dimensionality);
+        uint rowCount = 1, columnCount = 1;
+        const uint *rowChoices = &rows[row], *columnChoices = &columns[column];
+        if (column == 0) {
+            rowCount = findLineChoices(search->order, rows, row, search->rowChoices);
+            rowChoices = search->rowChoices;
+        }
+        if (row == 0) {
+            columnCount = findLineChoices(search->order, columns, column, search->columnChoices);
+            columnChoices = search->columnChoices;
+        }
+        for (uint r = 0; r < rowCount; r++) {
+            for (uint c = 0; c < columnCount; c++) {
+                uint label = labelForCell(search, state, rowChoices[r], columnChoices[c]);
+                if (label > best) { continue; }
+                if (label < best) {
+                    best = label;
+                    search->nextCount = 0;
+                    search->hasTooManyStates = 0;
+                }
+                if (search->nextCount == search->maxStates) {
+                    search->hasTooManyStates = 1;
+                    continue;
+                }
+                pushState(search, state, row, column, rowChoices[r], columnChoices[c]);
+            }
+        }
+    }
+
+    uint *states = search->states, capacity = search->stateCapacity;
+    search->states = search->nextStates;
+    search->stateCount = search->nextCount;
+    search->stateCapacity = search->nextCapacity;
+    search->nextStates = states;
+    search->nextCapacity = capacity;
+    return best;
+}
+
+#pragma mark Public Functions
+
+int canonicalizeGrid(uint order, const uint *grid, uint *canonical, MCSudokuTransform *transform)
+{
+    uint dimensionality = order * order;
+    MCCanonicalSearch search = {
+        .order = order,
+        .dimensionality = dimensionality,
+        .grid = grid,
+        .stateSize = MCStateLabels(dimensionality) + dimensionality + 1,
+        .maxStates = MCCanonicalMaxStates(dimensionality),
+        .stateCapacity = 64,
+        .nextCapacity = 64
+    };
+    search.states = calloc(search.stateCapacity, sizeof(uint) * search.stateSize);
+    search.nextStates = malloc(sizeof(uint) * search.nextCapacity * search.stateSize);
+    search.rowChoices = malloc(sizeof(uint) * dimensionality * 2);
+    search.columnChoices = search.rowChoices + dimensionality;
+
+    // The search starts with and without the grid transposed, before any rows, columns or numbers are chosen.
+    for (uint i = 0; i < 2; i++) {
+        search.states[i * search.stateSize + MCStateTransposed] = i;
+        search.states[i * search.stateSize + MCStateNextLabel] = 1;
+    }
+    search.stateCount = 2;
+    for (uint row = 0; row < dimensionality && !search.hasTooManyStates; row++) {
+        for (uint column = 0; column < dimensionality && !search.hasTooManyStates; column++) {
+            canonical[row * dimensionality + column] = searchCell(&search, row, column);
+        }
+    }
+
+    // Every state left gives the same grid. Numbers missing from it are labelled in order after those that aren't.
+    int isCanonical = !search.hasTooManyStates;
+    if (isCanonical && transform != NULL) {
+        const uint *state = search.states;
+        const uint *labels = state + MCStateLabels(dimensionality);
+        uint nextLabel = state[MCStateNextLabel];
+        transform->isTransposed = state[MCStateTransposed];
+        memcpy(transform->rows, state + MCStateRows, sizeof(uint) * dimensionality);
+        memcpy(transform->columns, state + MCStateColumns(dimensionality), sizeof(uint) * dimensionality);
+        transform->numbers[0] = 0;
+        for (uint number = 1; number <= dimensionality; number++) {
+            transform->numbers[number] = labels[number] != 0 ? labels[number] : nextLabel++;
+        }
+    }
+    free(search.states);
+    free(search.nextStates);
+    free(search.rowChoices);
+    return isCanonical;
+}
+
+#pragma mark Puzzle Sets
+
+static uint64_t hashPuzzle(const uint *puzzle, uint cellCount)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    for (uint i = 0; i < cellCount; i++) {
+        hash ^= puzzle[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static int isSamePuzzle(const unsigned char *stored, const uint *puzzle, uint cellCount)
+{
+    for (uint i = 0; i < cellCount; i++) {
+        if (stored[i] != puzzle[i]) { return 0; }
+    }
+    return 1;
+}
+
+static void growPuzzleSet(MCPuzzleSet *set)
+{
+    uint64_t *hashes = set->hashes;
+    uint *slots = set->slots, capacity = set->capacity;
+    set->capacity *= 2;
+    set->hashes = malloc(sizeof(uint64_t) * set->capacity);
+    set->slots = calloc(set->capacity, sizeof(uint));
+    for (uint i = 0; i < capacity; i++) {
+        if (slots[i] == 0) { continue; }
+        uint slot = (uint)hashes[i] & (set->capacity - 1);
+        while (set->slots[slot] != 0) { slot = (slot + 1) & (set->capacity - 1); }
+        set->hashes[slot] = hashes[i];
+        set->slots[slot] = slots[i];
+    }
+    free(hashes);
+    free(slots);
+}
+
+MCPuzzleSet *createPuzzleSet(uint order)
+{
+    uint dimensionality = order * order;
+    if (order == 0 || dimensionality > UCHAR_MAX) { return NULL; }
+    MCPuzzleSet *set = malloc(sizeof(MCPuzzleSet));
+    set->order = order;
+    set->cellCount = dimensionality * dimensionality;
+    set->count = 0;
+    set->capacity = MCPuzzleSetMinCapacity;
+    set->hashes = malloc(sizeof(uint64_t) * set->capacity);
+    set->slots = calloc(set->capacity, sizeof(uint));
+    set->puzzleCapacity = MCPuzzleSetMinCapacity / 2;
+    set->puzzles = malloc(set->puzzleCapacity * set->cellCount);
+    set->canonical = malloc(sizeof(uint) * set->cellCount);
+    return set;
+}
+
+void destroyPuzzleSet(MCPuzzleSet *set)
+{
+    if (set == NULL) { return; }
+    free(set->hashes);
+    free(set->slots);
+    free(set->puzzles);
+    free(set->canonical);
+    free(set);
+}
+
+int addPuzzleToSet(MCPuzzleSet *set, const uint *puzzle)
+{
+    uint cellCount = set->cellCount;
+    if (!canonicalizeGrid(set->order, puzzle, set->canonical, NULL)) { return -1; }
+    uint64_t hash = hashPuzzle(set->canonical, cellCount);
+    uint slot = (uint)hash & (set->capacity - 1);
+    for (; set->slots[slot] != 0; slot = (slot + 1) & (set->capacity - 1)) {
+        const unsigned char *stored = set->puzzles + (size_t)(set->slots[slot] - 1) * cellCount;
+        if (set->hashes[slot] == hash && isSamePuzzle(stored, set->canonical, cellCount)) { return 0; }
+    }
+
+    if (set->count == set->puzzleCapacity) {
+        set->puzzleCapacity *= 2;
+        set->puzzles = realloc(set->puzzles, (size_t)set->puzzleCapacity * cellCount);
+    }
+    unsigned char *stored = set->puzzles + (size_t)set->count * cellCount;
+    for (uint i = 0; i < cellCount; i++) { stored[i] = set->canonical[i]; }
+    set->hashes[slot] = hash;
+    set->slots[slot] = ++set->count;
+    if (set->count * 2 > set->capacity) { growPuzzleSet(set); }
+    return 1;
+}
+
+uint puzzleSetCount(const MCPuzzleSet *set)
+{
+    return set->count;
+}
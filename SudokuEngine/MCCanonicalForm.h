@@ -0,0 +1,47 @@
+//
+//  MCCanonicalForm.h
+//  Sudoku++
+//
+//  Created by Maarut Chandegra on 17/10/2026.
+//  Copyright © 2026 Maarut Chandegra. All rights reserved.
+//
+
+#ifndef MCCanonicalForm_h
+#define MCCanonicalForm_h
+
+#include "MCSudokuTransform.h"
+#include <sys/types.h>
+
+// Every puzzle has a canonical form: of all the grids its symmetries turn it into, the one that comes first reading
+// across each row in turn, empty cells counting as 0. Two puzzles have the same canonical form exactly when one is a
+// symmetry of the other, so it can stand in for the whole family when looking for duplicates.
+//
+// Finding it means following every symmetry that is still tied for the smallest grid so far. For a puzzle with one
+// solution the ties die out within the first few rows, but for a nearly empty grid they don't: an empty 9x9 grid
+// ties millions of them. The search gives up once more than MCCanonicalMaxStates are tied for a cell: about 118,000
+// for a 9x9 grid, under 20MB, and 2 million for a 16x16 one, several hundred MB. Puzzles with a unique solution have
+// needed well under half that.
+#define MCCanonicalMaxStates(dimensionality) \
+    (2 * (dimensionality) * (dimensionality) * (dimensionality) * (dimensionality) * (dimensionality))
+
+// Writes the canonical form of grid, cellCount numbers, to canonical, which mustn't overlap grid. If transform isn't
+// NULL it is set to a symmetry that turns grid into canonical, which can then be applied to its solution too. Returns
+// 1, or 0 if grid has too few clues to search, in which case canonical is left partly written and transform as it was.
+int canonicalizeGrid(uint order, const uint *grid, uint *canonical, MCSudokuTransform *transform);
+
+// A set of puzzles that holds at most one from each family of symmetric puzzles, for weeding the duplicates out of a
+// collection. Only the canonical forms are kept, one byte per cell, so orders above 15 aren't supported. Not thread
+// safe.
+typedef struct _MCPuzzleSet MCPuzzleSet;
+
+MCPuzzleSet *createPuzzleSet(uint order);
+void destroyPuzzleSet(MCPuzzleSet *set);
+
+// Adds puzzle, cellCount numbers, to the set. Returns 1 if it was added, 0 if the set already had it or one of its
+// symmetries, or -1 if it has too few clues for its canonical form to be found.
+int addPuzzleToSet(MCPuzzleSet *set, const uint *puzzle);
+
+// The number of puzzles that have been added.
+uint puzzleSetCount(const MCPuzzleSet *set);
+
+#endif /* MCCanonicalForm_h */
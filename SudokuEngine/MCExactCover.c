@@ -0,0 +1,205 @@
+//
+//  MCExactCover.c
+//  Sudoku++
+//
+//  Created by Maarut Chandegra on 17/10/2026.
+//  Copyright © 2026 Maarut Chandegra. All rights reserved.
+//
+
+#include "MCExactCover.h"
+#include "MCSudokuTopology.h"
+#include <stdlib.h>
+#include <string.h>
+
+#pragma mark Typedefs
+
+// Node 0 is the root, nodes 1 to columnCount are the column headers and the rest belong to the candidate rows. Each
+// candidate row places one number in one cell and is made up of four nodes, one for each constraint it satisfies.
+typedef struct _MCDancingLinks {
+    uint *left;
+    uint *right;
+    uint *up;
+    uint *down;
+    uint *column;       // The header of the column a node is in.
+    uint *candidate;    // cell * dimensionality + (number - 1) for row nodes.
+    uint *size;         // size[column], the number of rows left in a column.
+    uint *selected;     // selected[cellCount], the node chosen at each depth of the search.
+    uint nodeCount;
+    uint dimensionality;
+    uint solutionCount;
+    uint guessCount;    // Rows tried in columns that had more than one left.
+    uint limit;
+    uint *solution;
+} MCDancingLinks;
+
+#pragma mark Building the Matrix
+
+static void appendToColumn(MCDancingLinks *links, uint column, uint node)
+{
+    links->column[node] = column;
+    links->up[node] = links->up[column];
+    links->down[node] = column;
+    links->down[links->up[column]] = node;
+    links->up[column] = node;
+    links->size[column]++;
+}
+
+static void appendCandidate(MCDancingLinks *links, const MCSudokuSolveContext *context, uint cell, uint number)
+{
+    uint dimensionality = context->dimensionality, cellCount = context->cellCount;
+    const MCSudokuTopology *topology = context->topology;
+    uint row = topology->cellRow[cell], column = topology->cellColumn[cell], box = topology->cellBox[cell];
+    uint columns[4] = {
+        1 + cell,
+        1 + cellCount + row * dimensionality + number,
+        1 + cellCount * 2 + column * dimensionality + number,
+        1 + cellCount * 3 + box * dimensionality + number
+    };
+    uint first = links->nodeCount;
+    for (uint i = 0; i < 4; i++) {
+        uint node = links->nodeCount++;
+        links->candidate[node] = cell * dimensionality + number;
+        links->left[node] = i == 0 ? first + 3 : node - 1;
+        links->right[node] = i == 3 ? first : node + 1;
+        appendToColumn(links, columns[i], node);
+    }
+}
+
+// Givens only get the row for their number, and numbers already given to a neighbour are left out of a cell
+// altogether. Givens that clash leave a column that can't be covered, so the search finds nothing.
+static int createDancingLinks(MCDancingLinks *links, const MCSudokuSolveContext *context, const uint *problem)
+{
+    uint dimensionality = context->dimensionality, columnCount = context->cellCount * 4;
+    for (uint i = 0; i < context->cellCount; i++) {
+        if (problem[i] > dimensionality) { return 0; }
+    }
+
+    size_t maxNodes = 1 + columnCount + context->cellCount * dimensionality * 4;
+    links->left = malloc(sizeof(uint) * maxNodes * 6);
+    links->right = links->left + maxNodes;
+    links->up = links->right + maxNodes;
+    links->down = links->up + maxNodes;
+    links->column = links->down + maxNodes;
+    links->candidate = links->column + maxNodes;
+    links->size = calloc(columnCount + 1, sizeof(uint));
+    links->selected = malloc(sizeof(uint) * context->cellCount);
+    links->dimensionality = dimensionality;
+
+    for (uint i = 0; i <= columnCount; i++) {
+        links->left[i] = i == 0 ? columnCount : i - 1;
+        links->right[i] = i == columnCount ? 0 : i + 1;
+        links->up[i] = i;
+        links->down[i] = i;
+        links->column[i] = i;
+    }
+    links->nodeCount = columnCount + 1;
+
+    char *isTaken = malloc(dimensionality);
+    for (uint i = 0; i < context->cellCount; i++) {
+        if (problem[i] != 0) {
+            appendCandidate(links, context, i, problem[i] - 1);
+            continue;
+        }
+        memset(isTaken, 0, dimensionality);
+        for (uint j = 0; j < context->neighbourCount; j++) {
+            uint number = problem[context->neighbourMap[i][j]];
+            if (number != 0) { isTaken[number - 1] = 1; }
+        }
+        for (uint number = 0; number < dimensionality; number++) {
+            if (!isTaken[number]) { appendCandidate(links, context, i, number); }
+        }
+    }
+    free(isTaken);
+    return 1;
+}
+
+static void destroyDancingLinks(MCDancingLinks *links)
+{
+    free(links->left);
+    free(links->size);
+    free(links->selected);
+}
+
+#pragma mark Search
+
+static void cover(MCDancingLinks *links, uint column)
+{
+    links->right[links->left[column]] = links->right[column];
+    links->left[links->right[column]] = links->left[column];
+    for (uint i = links->down[column]; i != column; i = links->down[i]) {
+        for (uint j = links->right[i]; j != i; j = links->right[j]) {
+            links->down[links->up[j]] = links->down[j];
+            links->up[links->down[j]] = links->up[j];
+            links->size[links->column[j]]--;
+        }
+    }
+}
+
+static void uncover(MCDancingLinks *links, uint column)
+{
+    for (uint i = links->up[column]; i != column; i = links->up[i]) {
+        for (uint j = links->left[i]; j != i; j = links->left[j]) {
+            links->size[links->column[j]]++;
+            links->down[links->up[j]] = j;
+            links->up[links->down[j]] = j;
+        }
+    }
+    links->right[links->left[column]] = column;
+    links->left[links->right[column]] = column;
+}
+
+static void recordSolution(MCDancingLinks *links, uint depth)
+{
+    if (links->solutionCount++ > 0 || links->solution == NULL) { return; }
+    for (uint i = 0; i < depth; i++) {
+        uint candidate = links->candidate[links->selected[i]];
+        links->solution[candidate / links->dimensionality] = candidate % links->dimensionality + 1;
+    }
+}
+
+// Returns 1 once the limit has been reached.
+static int search(MCDancingLinks *links, uint depth)
+{
+    if (links->right[0] == 0) {
+        recordSolution(links, depth);
+        return links->solutionCount >= links->limit;
+    }
+
+    uint column = links->right[0];
+    for (uint i = links->right[column]; i != 0 && links->size[column] > 1; i = links->right[i]) {
+        if (links->size[i] < links->size[column]) { column = i; }
+    }
+    if (links->size[column] == 0) { return 0; }
+
+    int isDone = 0;
+    int isGuess = links->size[column] > 1;
+    cover(links, column);
+    for (uint i = links->down[column]; i != column && !isDone; i = links->down[i]) {
+        links->selected[depth] = i;
+        links->guessCount += isGuess;
+        for (uint j = links->right[i]; j != i; j = links->right[j]) { cover(links, links->column[j]); }
+        isDone = search(links, depth + 1);
+        for (uint j = links->left[i]; j != i; j = links->left[j]) { uncover(links, links->column[j]); }
+    }
+    uncover(links, column);
+    return isDone;
+}
+
+#pragma mark Public Functions
+
+uint countExactCoverSolutions(const MCSudokuSolveContext *context, const uint *problem, uint *solution, uint limit,
+    uint *guessCount)
+{
+    if (guessCount != NULL) { *guessCount = 0; }
+    if (limit == 0) { return 0; }
+    MCDancingLinks links;
+    if (!createDancingLinks(&links, context, problem)) { return 0; }
+    links.solutionCount = 0;
+    links.guessCount = 0;
+    links.limit = limit;
+    links.solution = solution;
+    search(&links, 0);
+    destroyDancingLinks(&links);
+    if (guessCount != NULL) { *guessCount = links.guessCount; }
+    return links.solutionCount;
+}
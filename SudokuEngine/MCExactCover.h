@@ -0,0 +1,24 @@
+//
+//  MCExactCover.h
+//  Sudoku++
+//
+//  Created by Maarut Chandegra on 17/10/2026.
+//  Copyright © 2026 Maarut Chandegra. All rights reserved.
+//
+
+#ifndef MCExactCover_h
+#define MCExactCover_h
+
+#include "MCSudokuEngine.h"
+
+// Solves a puzzle as an exact cover problem with Knuth's Dancing Links. Every cell, and every number in every row,
+// column and box, must be covered exactly once. There's no attempt to solve the puzzle the way a person would, so
+// this is only useful when the solutions matter and the difficulty doesn't.
+
+// Counts the solutions to problem, giving up once limit have been found. The first solution found is copied to
+// solution and the number of times a cell had to be guessed is written to guessCount, either of which may be NULL.
+// Only the context's dimensions and maps are used.
+uint countExactCoverSolutions(const MCSudokuSolveContext *context, const uint *problem, uint *solution, uint limit,
+    uint *guessCount);
+
+#endif /* MCExactCover_h */
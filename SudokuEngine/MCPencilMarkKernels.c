@@ -0,0 +1,180 @@
+//
+//  MCPencilMarkKernels.c
+//  Sudoku++
+//
+//  Created by Maarut Chandegra on 17/10/2026.
+//  Copyright © 2026 Maarut Chandegra. All rights reserved.
+//
+
+#include "MCPencilMarkKernels.h"
+#include <pthread.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define MCHasX86Kernels 1
+#include <immintrin.h>
+#else
+#define MCHasX86Kernels 0
+#endif
+
+#pragma mark Scalar Kernels
+
+static inline void reduceScalar(const MCPencilMarkWord *words, uint count, MCPencilMarkWord *seen,
+    MCPencilMarkWord *seenTwice)
+{
+    MCPencilMarkWord once = *seen, twice = *seenTwice;
+    for (uint i = 0; i < count; i++) {
+        twice |= once & words[i];
+        once |= words[i];
+    }
+    *seen = once;
+    *seenTwice = twice;
+}
+
+static void reducePencilMarkWordsScalar(const MCPencilMarkWord *words, uint count, MCPencilMarkWord *seen,
+    MCPencilMarkWord *seenTwice)
+{
+    *seen = 0;
+    *seenTwice = 0;
+    reduceScalar(words, count, seen, seenTwice);
+}
+
+static void countPencilMarkWordsScalar(const MCPencilMarkWord *words, uint count, uint8_t *counts)
+{
+    for (uint i = 0; i < count; i++) { counts[i] = __builtin_popcountll(words[i]); }
+}
+
+#if MCHasX86Kernels
+
+#pragma mark Lanes
+
+// Folds per lane results together. A mark is seen twice if it was seen twice in any lane, or once in two of them.
+static inline void foldLanes(const uint64_t *once, const uint64_t *twice, uint laneCount, MCPencilMarkWord *seen,
+    MCPencilMarkWord *seenTwice)
+{
+    MCPencilMarkWord foldedOnce = 0, foldedTwice = 0;
+    for (uint i = 0; i < laneCount; i++) {
+        foldedTwice |= twice[i] | (foldedOnce & once[i]);
+        foldedOnce |= once[i];
+    }
+    *seen = foldedOnce;
+    *seenTwice = foldedTwice;
+}
+
+#pragma mark SSE2 Kernels
+
+__attribute__((target("sse2")))
+static void reducePencilMarkWordsSSE2(const MCPencilMarkWord *words, uint count, MCPencilMarkWord *seen,
+    MCPencilMarkWord *seenTwice)
+{
+    __m128i once = _mm_setzero_si128(), twice = _mm_setzero_si128();
+    uint i = 0;
+    for (; i + 2 <= count; i += 2) {
+        __m128i word = _mm_loadu_si128((const __m128i *)(words + i));
+        twice = _mm_or_si128(twice, _mm_and_si128(once, word));
+        once = _mm_or_si128(once, word);
+    }
+    uint64_t onceLanes[2], twiceLanes[2];
+    _mm_storeu_si128((__m128i *)onceLanes, once);
+    _mm_storeu_si128((__m128i *)twiceLanes, twice);
+    foldLanes(onceLanes, twiceLanes, 2, seen, seenTwice);
+    reduceScalar(words + i, count - i, seen, seenTwice);
+}
+
+// SSE2 has no popcount, so bits are summed in pairs, nibbles and bytes, then the bytes of each word added together.
+__attribute__((target("sse2")))
+static void countPencilMarkWordsSSE2(const MCPencilMarkWord *words, uint count, uint8_t *counts)
+{
+    const __m128i pairs = _mm_set1_epi8(0x55), nibbles = _mm_set1_epi8(0x33), bytes = _mm_set1_epi8(0x0F);
+    uint i = 0;
+    for (; i + 2 <= count; i += 2) {
+        __m128i word = _mm_loadu_si128((const __m128i *)(words + i));
+        word = _mm_sub_epi64(word, _mm_and_si128(_mm_srli_epi64(word, 1), pairs));
+        word = _mm_add_epi64(_mm_and_si128(word, nibbles), _mm_and_si128(_mm_srli_epi64(word, 2), nibbles));
+        word = _mm_and_si128(_mm_add_epi64(word, _mm_srli_epi64(word, 4)), bytes);
+        word = _mm_sad_epu8(word, _mm_setzero_si128());
+        counts[i] = (uint8_t)_mm_cvtsi128_si32(word);
+        counts[i + 1] = (uint8_t)_mm_cvtsi128_si32(_mm_srli_si128(word, 8));
+    }
+    countPencilMarkWordsScalar(words + i, count - i, counts + i);
+}
+
+#pragma mark AVX2 Kernels
+
+__attribute__((target("avx2")))
+static void reducePencilMarkWordsAVX2(const MCPencilMarkWord *words, uint count, MCPencilMarkWord *seen,
+    MCPencilMarkWord *seenTwice)
+{
+    __m256i once = _mm256_setzero_si256(), twice = _mm256_setzero_si256();
+    uint i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m256i word = _mm256_loadu_si256((const __m256i *)(words + i));
+        twice = _mm256_or_si256(twice, _mm256_and_si256(once, word));
+        once = _mm256_or_si256(once, word);
+    }
+    uint64_t onceLanes[4], twiceLanes[4];
+    _mm256_storeu_si256((__m256i *)onceLanes, once);
+    _mm256_storeu_si256((__m256i *)twiceLanes, twice);
+    foldLanes(onceLanes, twiceLanes, 4, seen, seenTwice);
+    reduceScalar(words + i, count - i, seen, seenTwice);
+}
+
+// Looks up the bit count of each nibble, then adds up the bytes of each word.
+__attribute__((target("avx2")))
+static void countPencilMarkWordsAVX2(const MCPencilMarkWord *words, uint count, uint8_t *counts)
+{
+    const __m256i lookup = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                            0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i nibble = _mm256_set1_epi8(0x0F);
+    uint i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m256i word = _mm256_loadu_si256((const __m256i *)(words + i));
+        __m256i low = _mm256_shuffle_epi8(lookup, _mm256_and_si256(word, nibble));
+        __m256i high = _mm256_shuffle_epi8(lookup, _mm256_and_si256(_mm256_srli_epi64(word, 4), nibble));
+        __m256i sums = _mm256_sad_epu8(_mm256_add_epi8(low, high), _mm256_setzero_si256());
+        uint64_t lanes[4];
+        _mm256_storeu_si256((__m256i *)lanes, sums);
+        for (uint j = 0; j < 4; j++) { counts[i + j] = (uint8_t)lanes[j]; }
+    }
+    countPencilMarkWordsScalar(words + i, count - i, counts + i);
+}
+
+#endif // MCHasX86Kernels
+
+#pragma mark Dispatch
+
+static const MCPencilMarkKernels allKernels[] = {
+    { "scalar", reducePencilMarkWordsScalar, countPencilMarkWordsScalar },
+#if MCHasX86Kernels
+    { "sse2", reducePencilMarkWordsSSE2, countPencilMarkWordsSSE2 },
+    { "avx2", reducePencilMarkWordsAVX2, countPencilMarkWordsAVX2 },
+#endif
+};
+
+static uint availableKernelCount = 1;
+static pthread_once_t kernelsOnce = PTHREAD_ONCE_INIT;
+
+// allKernels is in order of the instructions each set needs, so the ones the processor can run come first.
+static void findAvailableKernels(void)
+{
+#if MCHasX86Kernels
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse2")) { availableKernelCount = 2; }
+    if (__builtin_cpu_supports("sse2") && __builtin_cpu_supports("avx2")) { availableKernelCount = 3; }
+#endif
+}
+
+#pragma mark Public Functions
+
+const MCPencilMarkKernels *availablePencilMarkKernels(uint *count)
+{
+    pthread_once(&kernelsOnce, findAvailableKernels);
+    *count = availableKernelCount;
+    return allKernels;
+}
+
+const MCPencilMarkKernels *pencilMarkKernels(void)
+{
+    uint count;
+    const MCPencilMarkKernels *kernels = availablePencilMarkKernels(&count);
+    return &kernels[count - 1];
+}
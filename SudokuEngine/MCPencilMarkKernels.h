@@ -0,0 +1,34 @@
+//
+//  MCPencilMarkKernels.h
+//  Sudoku++
+//
+//  Created by Maarut Chandegra on 17/10/2026.
+//  Copyright © 2026 Maarut Chandegra. All rights reserved.
+//
+
+#ifndef MCPencilMarkKernels_h
+#define MCPencilMarkKernels_h
+
+#include "MCSudokuEngine.h"
+
+// Scans over runs of pencil mark words, a unit or a whole board at a time. On x86 there are AVX2 and SSE2 versions
+// as well as plain loops, which everywhere else the compiler is free to vectorise. Solves pick the set of kernels to
+// use once, when their state is created, and call through it.
+
+typedef struct _MCPencilMarkKernels {
+    const char *name;
+    
+    // Sets seen to the pencil marks set in at least one of the words and seenTwice to those set in at least two.
+    void (*reduce)(const MCPencilMarkWord *words, uint count, MCPencilMarkWord *seen, MCPencilMarkWord *seenTwice);
+    
+    // Writes the number of pencil marks set in each of the words to counts.
+    void (*count)(const MCPencilMarkWord *words, uint count, uint8_t *counts);
+} MCPencilMarkKernels;
+
+// Every set of kernels the processor can run, the plain loops first and the fastest last, and how many there are.
+const MCPencilMarkKernels *availablePencilMarkKernels(uint *count);
+
+// The fastest set of kernels the processor can run.
+const MCPencilMarkKernels *pencilMarkKernels(void);
+
+#endif /* MCPencilMarkKernels_h */
@@ -0,0 +1,269 @@
+//
+//  MCPuzzleBank.c
+//  Sudoku++
+//
+//  Created by Maarut Chandegra on 17/10/2026.
+//  Copyright © 2026 Maarut Chandegra. All rights reserved.
+//
+
+#include "MCPuzzleBank.h"
+#include "MCRandom.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#pragma mark Typedefs
+
+#define MCPuzzleBankMagic       "MCPB"
+#define MCPuzzleBankVersion     1
+#define MCPuzzleBankHeaderSize  16
+#define MCPuzzleBankSectionSize 16
+#define MCPuzzleBankMaxOrder    15
+
+struct _MCPuzzleBank {
+    const unsigned char *bytes;     // The whole file, mapped read only.
+    size_t size;
+    uint sectionCount;
+};
+
+typedef struct _MCPuzzleBankSection {
+    uint order;
+    MCPuzzleDifficulty difficulty;
+    uint count;
+    uint capacity;
+    unsigned char *records;         // records[capacity * recordSize]
+} MCPuzzleBankSection;
+
+struct _MCPuzzleBankBuilder {
+    MCPuzzleBankSection *sections;
+    uint sectionCount;
+};
+
+#pragma mark Encoding
+
+static uint64_t readNumber(const unsigned char *bytes, uint size)
+{
+    uint64_t number = 0;
+    for (uint i = size; i > 0; i--) { number = number << 8 | bytes[i - 1]; }
+    return number;
+}
+
+static void writeNumber(unsigned char *bytes, uint64_t number, uint size)
+{
+    for (uint i = 0; i < size; i++, number >>= 8) { bytes[i] = number & 0xff; }
+}
+
+// Solutions are stored one less than each number, in just enough bits for the largest.
+static uint bitsPerNumber(uint order)
+{
+    uint bits = 1;
+    while ((1u << bits) < order * order) { bits++; }
+    return bits;
+}
+
+// A 4 byte score, then the given bits, then the solution.
+static size_t recordSize(uint order)
+{
+    size_t cellCount = order * order * order * order;
+    return 4 + (cellCount + 7) / 8 + (cellCount * bitsPerNumber(order) + 7) / 8;
+}
+
+static void encodePuzzle(const MCSudokuSolveContext *puzzle, unsigned char *record)
+{
+    uint cellCount = puzzle->cellCount, bits = bitsPerNumber(puzzle->order);
+    memset(record, 0, recordSize(puzzle->order));
+    writeNumber(record, puzzle->difficultyScore, 4);
+    unsigned char *givens = record + 4, *solution = givens + (cellCount + 7) / 8;
+    for (uint i = 0; i < cellCount; i++) {
+        if (puzzle->problem[i] != 0) { givens[i / 8] |= 1 << (i % 8); }
+        for (uint bit = 0; bit < bits; bit++) {
+            size_t position = (size_t)i * bits + bit;
+            if ((puzzle->solution[i] - 1) >> bit & 1) { solution[position / 8] |= 1 << (position % 8); }
+        }
+    }
+}
+
+// Returns 0 if the record holds a number too big for the puzzle, which only a damaged file would.
+static int decodePuzzle(const unsigned char *record, MCSudokuSolveContext *puzzle)
+{
+    uint cellCount = puzzle->cellCount, bits = bitsPerNumber(puzzle->order);
+    const unsigned char *givens = record + 4, *solution = givens + (cellCount + 7) / 8;
+    puzzle->difficultyScore = (uint)readNumber(record, 4);
+    for (uint i = 0; i < cellCount; i++) {
+        uint number = 0;
+        for (uint bit = 0; bit < bits; bit++) {
+            size_t position = (size_t)i * bits + bit;
+            number |= (uint)(solution[position / 8] >> (position % 8) & 1) << bit;
+        }
+        if (number >= puzzle->dimensionality) { return 0; }
+        puzzle->solution[i] = number + 1;
+        puzzle->problem[i] = givens[i / 8] >> (i % 8) & 1 ? number + 1 : 0;
+    }
+    return 1;
+}
+
+#pragma mark Reading
+
+// Returns NULL if the bank has no section for the order and difficulty.
+static const unsigned char *findSection(const MCPuzzleBank *bank, uint order, MCPuzzleDifficulty difficulty)
+{
+    for (uint i = 0; i < bank->sectionCount; i++) {
+        const unsigned char *section = bank->bytes + MCPuzzleBankHeaderSize + i * MCPuzzleBankSectionSize;
+        if (readNumber(section, 2) == order && readNumber(section + 2, 2) == difficulty) { return section; }
+    }
+    return NULL;
+}
+
+// Every section has to fit in the file for a puzzle to be found without checking it each time.
+static int isBankValid(const MCPuzzleBank *bank)
+{
+    if (bank->size < MCPuzzleBankHeaderSize) { return 0; }
+    if (memcmp(bank->bytes, MCPuzzleBankMagic, 4) != 0) { return 0; }
+    if (readNumber(bank->bytes + 4, 4) != MCPuzzleBankVersion) { return 0; }
+    uint64_t sectionCount = readNumber(bank->bytes + 8, 4);
+    if (sectionCount > (bank->size - MCPuzzleBankHeaderSize) / MCPuzzleBankSectionSize) { return 0; }
+    for (uint i = 0; i < sectionCount; i++) {
+        const unsigned char *section = bank->bytes + MCPuzzleBankHeaderSize + i * MCPuzzleBankSectionSize;
+        uint64_t order = readNumber(section, 2), count = readNumber(section + 4, 4);
+        uint64_t offset = readNumber(section + 8, 8);
+        if (order < 2 || order > MCPuzzleBankMaxOrder || offset > bank->size) { return 0; }
+        if (count > (bank->size - offset) / recordSize((uint)order)) { return 0; }
+    }
+    return 1;
+}
+
+MCPuzzleBank *openPuzzleBank(const char *path)
+{
+    int file = open(path, O_RDONLY);
+    if (file == -1) { return NULL; }
+    struct stat status;
+    if (fstat(file, &status) == -1 || status.st_size < MCPuzzleBankHeaderSize) {
+        close(file);
+        return NULL;
+    }
+    void *bytes = mmap(NULL, status.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+    close(file);
+    if (bytes == MAP_FAILED) { return NULL; }
+
+    MCPuzzleBank *bank = malloc(sizeof(MCPuzzleBank));
+    bank->bytes = bytes;
+    bank->size = status.st_size;
+    if (!isBankValid(bank)) {
+        closePuzzleBank(bank);
+        return NULL;
+    }
+    bank->sectionCount = (uint)readNumber(bank->bytes + 8, 4);
+    return bank;
+}
+
+void closePuzzleBank(MCPuzzleBank *bank)
+{
+    if (bank == NULL) { return; }
+    munmap((void *)bank->bytes, bank->size);
+    free(bank);
+}
+
+uint puzzleBankCount(const MCPuzzleBank *bank, uint order, MCPuzzleDifficulty difficulty)
+{
+    const unsigned char *section = findSection(bank, order, difficulty);
+    return section != NULL ? (uint)readNumber(section + 4, 4) : 0;
+}
+
+MCSudokuSolveContext *createPuzzleFromBank(const MCPuzzleBank *bank, uint order, MCPuzzleDifficulty difficulty,
+    uint64_t seed)
+{
+    const unsigned char *section = findSection(bank, order, difficulty);
+    uint count = section != NULL ? (uint)readNumber(section + 4, 4) : 0;
+    if (count == 0) { return NULL; }
+    MCRandomState random;
+    seedRandom(&random, seed);
+    uint index = randomBelow(&random, count);
+    const unsigned char *record = bank->bytes + readNumber(section + 8, 8) + index * recordSize(order);
+
+    MCSudokuSolveContext *puzzle = createContext(order);
+    if (!decodePuzzle(record, puzzle)) {
+        destroyContext(puzzle);
+        return NULL;
+    }
+    puzzle->solutionCount = 1;
+    puzzle->difficulty = difficulty;
+    puzzle->status = MCSolveStatusSolved;
+    MCSudokuSolveContext *isomorph = createIsomorphicPuzzle(puzzle, nextRandom(&random));
+    destroyContext(puzzle);
+    return isomorph;
+}
+
+#pragma mark Writing
+
+MCPuzzleBankBuilder *createPuzzleBankBuilder(void)
+{
+    MCPuzzleBankBuilder *builder = malloc(sizeof(MCPuzzleBankBuilder));
+    builder->sections = NULL;
+    builder->sectionCount = 0;
+    return builder;
+}
+
+void destroyPuzzleBankBuilder(MCPuzzleBankBuilder *builder)
+{
+    if (builder == NULL) { return; }
+    for (uint i = 0; i < builder->sectionCount; i++) { free(builder->sections[i].records); }
+    free(builder->sections);
+    free(builder);
+}
+
+int addPuzzleToBank(MCPuzzleBankBuilder *builder, const MCSudokuSolveContext *puzzle)
+{
+    if (puzzle->solutionCount != 1 || puzzle->order < 2 || puzzle->order > MCPuzzleBankMaxOrder) { return 0; }
+    MCPuzzleBankSection *section = NULL;
+    for (uint i = 0; i < builder->sectionCount && section == NULL; i++) {
+        MCPuzzleBankSection *candidate = &builder->sections[i];
+        if (candidate->order == puzzle->order && candidate->difficulty == puzzle->difficulty) { section = candidate; }
+    }
+    if (section == NULL) {
+        builder->sections = realloc(builder->sections, sizeof(MCPuzzleBankSection) * (builder->sectionCount + 1));
+        section = &builder->sections[builder->sectionCount++];
+        *section = (MCPuzzleBankSection){ puzzle->order, puzzle->difficulty, 0, 0, NULL };
+    }
+
+    size_t size = recordSize(puzzle->order);
+    if (section->count == section->capacity) {
+        section->capacity = section->capacity == 0 ? 64 : section->capacity * 2;
+        section->records = realloc(section->records, section->capacity * size);
+    }
+    encodePuzzle(puzzle, section->records + section->count++ * size);
+    return 1;
+}
+
+int writePuzzleBank(const MCPuzzleBankBuilder *builder, const char *path)
+{
+    unsigned char header[MCPuzzleBankHeaderSize] = { 0 };
+    memcpy(header, MCPuzzleBankMagic, 4);
+    writeNumber(header + 4, MCPuzzleBankVersion, 4);
+    writeNumber(header + 8, builder->sectionCount, 4);
+    FILE *file = fopen(path, "wb");
+    if (file == NULL) { return 0; }
+    int isWritten = fwrite(header, sizeof(header), 1, file) == 1;
+
+    uint64_t offset = MCPuzzleBankHeaderSize + builder->sectionCount * MCPuzzleBankSectionSize;
+    for (uint i = 0; i < builder->sectionCount && isWritten; i++) {
+        const MCPuzzleBankSection *section = &builder->sections[i];
+        unsigned char entry[MCPuzzleBankSectionSize];
+        writeNumber(entry, section->order, 2);
+        writeNumber(entry + 2, section->difficulty, 2);
+        writeNumber(entry + 4, section->count, 4);
+        writeNumber(entry + 8, offset, 8);
+        isWritten = fwrite(entry, sizeof(entry), 1, file) == 1;
+        offset += section->count * recordSize(section->order);
+    }
+    for (uint i = 0; i < builder->sectionCount && isWritten; i++) {
+        const MCPuzzleBankSection *section = &builder->sections[i];
+        size_t size = section->count * recordSize(section->order);
+        isWritten = fwrite(section->records, 1, size, file) == size;
+    }
+    if (fclose(file) != 0) { isWritten = 0; }
+    return isWritten;
+}
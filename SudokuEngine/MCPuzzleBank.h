@@ -0,0 +1,54 @@
+//
+//  MCPuzzleBank.h
+//  Sudoku++
+//
+//  Created by Maarut Chandegra on 17/10/2026.
+//  Copyright © 2026 Maarut Chandegra. All rights reserved.
+//
+
+#ifndef MCPuzzleBank_h
+#define MCPuzzleBank_h
+
+#include "MCSudokuEngine.h"
+
+// A bank is a file of puzzles generated ahead of time, so handing one out costs next to nothing. Puzzles are filed by
+// order and by the difficulty they were graded as, and each one is stored as its solution plus a bit per cell saying
+// whether it is given, along with its score: 56 bytes for a 9x9 puzzle. Banks are written by Tools/PuzzleBank.
+//
+// The file starts with a 16 byte header, the magic number "MCPB" then the version, the number of sections and a
+// reserved word, each 4 bytes. A table of 16 byte sections follows, each holding the order and difficulty in 2 bytes
+// apiece, then the number of puzzles in 4 and the offset of the first from the start of the file in 8. Every puzzle of
+// a section is the same size, so any one of them can be found straight away. Numbers are little endian throughout.
+
+typedef struct _MCPuzzleBank MCPuzzleBank;
+
+// Maps the bank at path into memory, which reads nothing until a puzzle is asked for. Returns NULL if the file can't
+// be opened or isn't a bank.
+MCPuzzleBank *openPuzzleBank(const char *path);
+void closePuzzleBank(MCPuzzleBank *bank);
+
+// The number of puzzles of the given order and difficulty in the bank.
+uint puzzleBankCount(const MCPuzzleBank *bank, uint order, MCPuzzleDifficulty difficulty);
+
+// Creates a context holding one of the bank's puzzles of the given order and difficulty, with its solution and
+// score, as generatePuzzleWithOrder would have left it. seed picks the puzzle, and which of its symmetries it is
+// handed out as, as createIsomorphicPuzzle would, so a small bank goes a long way. Returns NULL if the bank has no
+// puzzles of that order and difficulty.
+MCSudokuSolveContext *createPuzzleFromBank(const MCPuzzleBank *bank, uint order, MCPuzzleDifficulty difficulty,
+    uint64_t seed);
+
+// Collects puzzles in memory for writing out as a bank.
+typedef struct _MCPuzzleBankBuilder MCPuzzleBankBuilder;
+
+MCPuzzleBankBuilder *createPuzzleBankBuilder(void);
+void destroyPuzzleBankBuilder(MCPuzzleBankBuilder *builder);
+
+// Files puzzle under its order and difficulty. Returns 0, leaving the builder as it was, unless puzzle has a unique
+// solution.
+int addPuzzleToBank(MCPuzzleBankBuilder *builder, const MCSudokuSolveContext *puzzle);
+
+// Writes every puzzle added so far to path, replacing whatever was there. Returns 0, with errno set, if the file
+// couldn't be written.
+int writePuzzleBank(const MCPuzzleBankBuilder *builder, const char *path);
+
+#endif /* MCPuzzleBank_h */
@@ -0,0 +1,202 @@
+//
+//  MCPuzzlePool.c
+//  Sudoku++
+//
+//  Created by Maarut Chandegra on 17/10/2026.
+//  Copyright © 2026 Maarut Chandegra. All rights reserved.
+//
+
+#include "MCPuzzlePool.h"
+#include "MCTaskScheduler.h"
+#include <stdlib.h>
+#include <time.h>
+#ifdef __APPLE__
+#include <pthread/qos.h>
+#endif
+
+#pragma mark Typedefs
+
+#define MCPoolDifficultyCount 4
+
+static const MCPuzzleDifficulty poolDifficulties[MCPoolDifficultyCount] = {
+    MCPuzzleDifficultyEasy, MCPuzzleDifficultyNormal, MCPuzzleDifficultyHard, MCPuzzleDifficultyInsane
+};
+
+// The pool's thread holds lock except while it waits on condition, which is signalled whenever a puzzle is taken, a
+// refill finishes or the pool is closing.
+struct _MCPuzzlePool {
+    uint order;
+    uint capacity;
+    uint64_t seed;                      // The seed of the next puzzle generated, ahead of time or not.
+    MCSudokuSolveContext **puzzles;     // puzzles[MCPoolDifficultyCount][capacity]
+    uint readyCounts[MCPoolDifficultyCount];
+    MCSolveRequest *refill;             // The request generating a puzzle ahead of time, if there is one.
+    uint refillIndex;                   // Its difficulty, as an index into poolDifficulties.
+    double refillStart;
+    int isRefilling;
+    int isClosing;
+    MCPuzzlePoolStatistics statistics;
+    pthread_mutex_t lock;
+    pthread_cond_t condition;
+    pthread_t thread;
+};
+
+#pragma mark Refilling
+
+static double currentTime(void)
+{
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+static int indexOfDifficulty(MCPuzzleDifficulty difficulty)
+{
+    for (int i = 0; i < MCPoolDifficultyCount; i++) {
+        if (poolDifficulties[i] == difficulty) { return i; }
+    }
+    return -1;
+}
+
+// The difficulty with the fewest puzzles ready, or -1 if the pool is full.
+static int neediestDifficulty(const MCPuzzlePool *pool)
+{
+    int neediest = -1;
+    for (int i = 0; i < MCPoolDifficultyCount; i++) {
+        if (pool->readyCounts[i] == pool->capacity) { continue; }
+        if (neediest == -1 || pool->readyCounts[i] < pool->readyCounts[neediest]) { neediest = i; }
+    }
+    return neediest;
+}
+
+// Requests are started from the pool's thread, and their threads take its priority with them, as do the tasks they
+// spread over the task scheduler, which only runs them when it has nothing else to do. Only Apple platforms lower
+// the threads' own priority, elsewhere they compete with the app's threads as equals.
+static void lowerThreadPriority(void)
+{
+#ifdef __APPLE__
+    pthread_set_qos_class_self_np(QOS_CLASS_UTILITY, 0);
+#endif
+    setThreadSpawnsBackgroundTasks(1);
+}
+
+static void finishRefill(MCSudokuSolveContext *puzzle, void *info)
+{
+    MCPuzzlePool *pool = info;
+    pthread_mutex_lock(&pool->lock);
+    uint index = pool->refillIndex;
+    if (puzzle->status == MCSolveStatusSolved && pool->readyCounts[index] < pool->capacity) {
+        double seconds = currentTime() - pool->refillStart;
+        pool->puzzles[index * pool->capacity + pool->readyCounts[index]++] = puzzle;
+        pool->statistics.refillCount++;
+        pool->statistics.refillSeconds += seconds;
+        if (seconds > pool->statistics.longestRefillSeconds) { pool->statistics.longestRefillSeconds = seconds; }
+        puzzle = NULL;
+    }
+    pool->isRefilling = 0;
+    pthread_cond_broadcast(&pool->condition);
+    pthread_mutex_unlock(&pool->lock);
+    destroyContext(puzzle);
+}
+
+// Generates one puzzle at a time until the pool is closed. A request that can't be started is tried again the next
+// time a puzzle is taken.
+static void *runPuzzlePool(void *argument)
+{
+    MCPuzzlePool *pool = argument;
+    MCSolveBudget budget = { 0, 0 };
+    lowerThreadPriority();
+    pthread_mutex_lock(&pool->lock);
+    while (!pool->isClosing) {
+        int index = neediestDifficulty(pool);
+        MCSolveRequest *request = NULL;
+        if (index >= 0) {
+            pool->refillIndex = index;
+            pool->refillStart = currentTime();
+            pool->isRefilling = 1;
+            request = generatePuzzleAsync(pool->order, poolDifficulties[index], pool->seed++, budget, finishRefill,
+                pool);
+        }
+        if (request == NULL) {
+            pool->isRefilling = 0;
+            pthread_cond_wait(&pool->condition, &pool->lock);
+            continue;
+        }
+        pool->refill = request;
+        while (pool->isRefilling) { pthread_cond_wait(&pool->condition, &pool->lock); }
+        pool->refill = NULL;
+        releaseSolveRequest(request);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+#pragma mark Public Functions
+
+MCPuzzlePool *createPuzzlePool(uint order, uint capacity, uint64_t seed)
+{
+    if (order == 0 || capacity == 0) { return NULL; }
+    MCPuzzlePool *pool = calloc(1, sizeof(MCPuzzlePool));
+    pool->order = order;
+    pool->capacity = capacity;
+    pool->seed = seed;
+    pool->puzzles = malloc(sizeof(MCSudokuSolveContext *) * MCPoolDifficultyCount * capacity);
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->condition, NULL);
+    if (pthread_create(&pool->thread, NULL, runPuzzlePool, pool) != 0) {
+        pthread_cond_destroy(&pool->condition);
+        pthread_mutex_destroy(&pool->lock);
+        free(pool->puzzles);
+        free(pool);
+        return NULL;
+    }
+    return pool;
+}
+
+void destroyPuzzlePool(MCPuzzlePool *pool)
+{
+    if (pool == NULL) { return; }
+    pthread_mutex_lock(&pool->lock);
+    pool->isClosing = 1;
+    cancelSolveRequest(pool->refill);
+    pthread_cond_broadcast(&pool->condition);
+    pthread_mutex_unlock(&pool->lock);
+    pthread_join(pool->thread, NULL);
+
+    for (uint i = 0; i < MCPoolDifficultyCount; i++) {
+        for (uint j = 0; j < pool->readyCounts[i]; j++) { destroyContext(pool->puzzles[i * pool->capacity + j]); }
+    }
+    pthread_cond_destroy(&pool->condition);
+    pthread_mutex_destroy(&pool->lock);
+    free(pool->puzzles);
+    free(pool);
+}
+
+MCSudokuSolveContext *takePuzzleFromPool(MCPuzzlePool *pool, MCPuzzleDifficulty difficulty)
+{
+    if (pool == NULL) { return NULL; }
+    int index = indexOfDifficulty(difficulty);
+    if (index < 0) { return generatePuzzleWithOrder(pool->order, difficulty, 0); }
+    MCSudokuSolveContext *puzzle = NULL;
+    uint64_t seed = 0;
+    pthread_mutex_lock(&pool->lock);
+    if (pool->readyCounts[index] > 0) {
+        puzzle = pool->puzzles[index * pool->capacity + --pool->readyCounts[index]];
+        pool->statistics.hitCount++;
+        pthread_cond_broadcast(&pool->condition);
+    }
+    else {
+        seed = pool->seed++;
+        pool->statistics.missCount++;
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return puzzle != NULL ? puzzle : generatePuzzleWithOrder(pool->order, difficulty, seed);
+}
+
+MCPuzzlePoolStatistics puzzlePoolStatistics(MCPuzzlePool *pool)
+{
+    pthread_mutex_lock(&pool->lock);
+    MCPuzzlePoolStatistics statistics = pool->statistics;
+    pthread_mutex_unlock(&pool->lock);
+    return statistics;
+}
@@ -0,0 +1,42 @@
+//
+//  MCPuzzlePool.h
+//  Sudoku++
+//
+//  Created by Maarut Chandegra on 17/10/2026.
+//  Copyright © 2026 Maarut Chandegra. All rights reserved.
+//
+
+#ifndef MCPuzzlePool_h
+#define MCPuzzlePool_h
+
+#include "MCSudokuEngine.h"
+
+// Keeps a few puzzles of each difficulty generated ahead of time, so a new game rarely has to wait for one. Puzzles
+// are generated one at a time, the difficulty with the fewest ready first, by a thread of the pool's own. The tasks
+// it spreads over the task scheduler are background tasks, which wait for any other work. Only on Apple platforms
+// does the thread itself run at a low priority. The pool tops itself up whenever a puzzle is taken.
+
+typedef struct _MCPuzzlePool MCPuzzlePool;
+
+typedef struct _MCPuzzlePoolStatistics {
+    uint hitCount;                  // Puzzles taken that were ready.
+    uint missCount;                 // Puzzles taken that had to be generated while the caller waited.
+    uint refillCount;               // Puzzles generated ahead of time.
+    double refillSeconds;           // Time spent generating them, in total.
+    double longestRefillSeconds;
+} MCPuzzlePoolStatistics;
+
+// Starts filling a pool with capacity puzzles of each difficulty from easy to insane, generated from consecutive seeds
+// starting at seed. Returns NULL if the pool's thread couldn't be started.
+MCPuzzlePool *createPuzzlePool(uint order, uint capacity, uint64_t seed);
+
+// Cancels the puzzle being generated, waits for it to stop and destroys every puzzle left in the pool.
+void destroyPuzzlePool(MCPuzzlePool *pool);
+
+// Takes a ready puzzle of the given difficulty, which the caller must destroy. If there isn't one, it is generated
+// while the caller waits, as generatePuzzleWithOrder would. Safe to call from any thread.
+MCSudokuSolveContext *takePuzzleFromPool(MCPuzzlePool *pool, MCPuzzleDifficulty difficulty);
+
+MCPuzzlePoolStatistics puzzlePoolStatistics(MCPuzzlePool *pool);
+
+#endif /* MCPuzzlePool_h */
@@ -0,0 +1,57 @@
+//
+//  MCRandom.c
+//  Sudoku++
+//
+//  Created by Maarut Chandegra on 17/10/2026.
+//  Copyright © 2026 Maarut Chandegra. All rights reserved.
+//
+
+#include "MCRandom.h"
+
+static uint64_t splitMix(uint64_t *seed)
+{
+    uint64_t value = (*seed += 0x9E3779B97F4A7C15);
+    value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9;
+    value = (value ^ (value >> 27)) * 0x94D049BB133111EB;
+    return value ^ (value >> 31);
+}
+
+static uint64_t rotateLeft(uint64_t value, int shift)
+{
+    return (value << shift) | (value >> (64 - shift));
+}
+
+void seedRandom(MCRandomState *state, uint64_t seed)
+{
+    for (int i = 0; i < 4; i++) { state->words[i] = splitMix(&seed); }
+}
+
+MCRandomState splitRandom(const MCRandomState *state, uint64_t stream)
+{
+    uint64_t seed = state->words[0] ^ rotateLeft(state->words[1], 17) ^ rotateLeft(state->words[2], 31) ^
+        rotateLeft(state->words[3], 47);
+    seed ^= splitMix(&stream);
+    MCRandomState child;
+    seedRandom(&child, seed);
+    return child;
+}
+
+uint64_t nextRandom(MCRandomState *state)
+{
+    uint64_t *words = state->words;
+    uint64_t result = rotateLeft(words[1] * 5, 7) * 9;
+    uint64_t shifted = words[1] << 17;
+    words[2] ^= words[0];
+    words[3] ^= words[1];
+    words[1] ^= words[2];
+    words[0] ^= words[3];
+    words[2] ^= shifted;
+    words[3] = rotateLeft(words[3], 45);
+    return result;
+}
+
+uint randomBelow(MCRandomState *state, uint bound)
+{
+    // Scaling the top 32 bits is cheaper than a modulo and uses the generator's strongest bits.
+    return (uint)(((nextRandom(state) >> 32) * bound) >> 32);
+}
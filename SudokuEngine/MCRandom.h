@@ -0,0 +1,33 @@
+//
+//  MCRandom.h
+//  Sudoku++
+//
+//  Created by Maarut Chandegra on 17/10/2026.
+//  Copyright © 2026 Maarut Chandegra. All rights reserved.
+//
+
+#ifndef MCRandom_h
+#define MCRandom_h
+
+#include <stdint.h>
+#include <sys/types.h>
+
+// xoshiro256** seeded through SplitMix64. Each search branch and generation attempt owns its own state, so nothing
+// is shared between threads and the same seed always makes the same choices, however the work is scheduled.
+
+typedef struct _MCRandomState {
+    uint64_t words[4];
+} MCRandomState;
+
+void seedRandom(MCRandomState *state, uint64_t seed);
+
+// A new state for the stream'th child of state, leaving state itself untouched. Branches are seeded this way so that
+// a branch makes the same choices whether it runs in place or on another worker.
+MCRandomState splitRandom(const MCRandomState *state, uint64_t stream);
+
+uint64_t nextRandom(MCRandomState *state);
+
+// A number from 0 to bound - 1.
+uint randomBelow(MCRandomState *state, uint bound);
+
+#endif /* MCRandom_h */
@@ -0,0 +1,286 @@
+//
+//  MCSolutionGrid.c
+//  Sudoku++
+//
+//  Created by Maarut Chandegra on 17/10/2026.
+//  Copyright © 2026 Maarut Chandegra. All rights reserved.
+//
+
+#include "MCSolutionGrid.h"
+#include "MCSudokuTopology.h"
+#include "MCSudokuTransform.h"
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+#pragma mark Typedefs
+
+#define MCFillWordBits (sizeof(MCPencilMarkWord) * CHAR_BIT)
+
+// A fill that has placed this many numbers per cell without finishing is given up on and started again.
+#define MCFillPlacementsPerCell 4
+
+// The fills tried before falling back to shuffling a fixed grid. Orders above MCFillMaxOrder backtrack so much that
+// they go straight to the fixed grid.
+#define MCFillAttemptCount      32
+#define MCFillMaxOrder          5
+
+// A cell that has been filled, in the order they were filled.
+typedef struct _MCFillStep {
+    uint cell;
+    uint position;                  // Where the cell was in emptyCells when it was chosen.
+    uint number;                    // 0 while nothing is placed.
+} MCFillStep;
+
+typedef struct _MCGridFill {
+    const MCSudokuTopology *topology;
+    uint wordCount;
+    MCPencilMarkWord *used;         // used[dimensionality * 3][wordCount], the numbers in each row, column and box
+    MCPencilMarkWord *tried;        // tried[cellCount][wordCount], the numbers each step has given up on
+    MCPencilMarkWord *candidates;   // candidates[wordCount]
+    uint *candidateCounts;          // candidateCounts[cellCount], kept up to date for empty cells as numbers come and go
+    uint *emptyCells;               // emptyCells[cellCount], of which the first emptyCount are still empty
+    uint emptyCount;
+    MCFillStep *steps;              // steps[cellCount]
+    uint stepCount;
+    uint *grid;
+} MCGridFill;
+
+#pragma mark Setting Up
+
+static void createGridFill(MCGridFill *fill, const MCSudokuSolveContext *context, uint *grid)
+{
+    uint cellCount = context->cellCount, wordCount = context->pencilMarkWordCount;
+    fill->topology = context->topology;
+    fill->wordCount = wordCount;
+    fill->used = malloc(sizeof(MCPencilMarkWord) * wordCount * (context->dimensionality * 3 + cellCount + 1));
+    fill->tried = fill->used + context->dimensionality * 3 * wordCount;
+    fill->candidates = fill->tried + cellCount * wordCount;
+    fill->emptyCells = malloc(sizeof(uint) * cellCount * 2);
+    fill->candidateCounts = fill->emptyCells + cellCount;
+    fill->steps = malloc(sizeof(MCFillStep) * cellCount);
+    fill->grid = grid;
+}
+
+static void destroyGridFill(MCGridFill *fill)
+{
+    free(fill->used);
+    free(fill->emptyCells);
+    free(fill->steps);
+}
+
+static void clearGridFill(MCGridFill *fill)
+{
+    uint cellCount = fill->topology->cellCount;
+    memset(fill->used, 0, sizeof(MCPencilMarkWord) * fill->wordCount * fill->topology->dimensionality * 3);
+    memset(fill->grid, 0, sizeof(uint) * cellCount);
+    for (uint i = 0; i < cellCount; i++) {
+        fill->emptyCells[i] = i;
+        fill->candidateCounts[i] = fill->topology->dimensionality;
+    }
+    fill->emptyCount = cellCount;
+    fill->stepCount = 0;
+}
+
+#pragma mark Numbers
+
+static int isNumberUsed(MCGridFill *fill, uint cell, uint word, MCPencilMarkWord bit)
+{
+    const MCSudokuTopology *topology = fill->topology;
+    uint dimensionality = topology->dimensionality, wordCount = fill->wordCount;
+    return ((fill->used[topology->cellRow[cell] * wordCount + word] |
+        fill->used[(dimensionality + topology->cellColumn[cell]) * wordCount + word] |
+        fill->used[(dimensionality * 2 + topology->cellBox[cell]) * wordCount + word]) & bit) != 0;
+}
+
+// Every empty neighbour that could have held number before it was placed loses a candidate, and gets it back when
+// it's taken away again.
+static void setNumber(MCGridFill *fill, uint cell, uint number, int isPlaced)
+{
+    const MCSudokuTopology *topology = fill->topology;
+    uint units[3] = {
+        topology->cellRow[cell],
+        topology->dimensionality + topology->cellColumn[cell],
+        topology->dimensionality * 2 + topology->cellBox[cell]
+    };
+    uint word = (number - 1) / MCFillWordBits;
+    MCPencilMarkWord bit = (MCPencilMarkWord)1 << ((number - 1) % MCFillWordBits);
+    if (isPlaced) {
+        for (uint i = 0; i < topology->neighbourCount; i++) {
+            uint neighbour = topology->neighbourMap[cell][i];
+            if (fill->grid[neighbour] == 0 && !isNumberUsed(fill, neighbour, word, bit)) {
+                fill->candidateCounts[neighbour]--;
+            }
+        }
+    }
+    for (uint i = 0; i < 3; i++) {
+        MCPencilMarkWord *used = &fill->used[units[i] * fill->wordCount + word];
+        *used = isPlaced ? *used | bit : *used & ~bit;
+    }
+    if (!isPlaced) {
+        for (uint i = 0; i < topology->neighbourCount; i++) {
+            uint neighbour = topology->neighbourMap[cell][i];
+            if (fill->grid[neighbour] == 0 && !isNumberUsed(fill, neighbour, word, bit)) {
+                fill->candidateCounts[neighbour]++;
+            }
+        }
+    }
+    fill->grid[cell] = isPlaced ? number : 0;
+}
+
+// Writes the numbers cell could still take, other than those in excluded, to fill->candidates and returns how many
+// there are. excluded may be NULL.
+static uint findCandidates(MCGridFill *fill, uint cell, const MCPencilMarkWord *excluded)
+{
+    const MCSudokuTopology *topology = fill->topology;
+    uint dimensionality = topology->dimensionality, wordCount = fill->wordCount;
+    const MCPencilMarkWord *row = &fill->used[topology->cellRow[cell] * wordCount];
+    const MCPencilMarkWord *column = &fill->used[(dimensionality + topology->cellColumn[cell]) * wordCount];
+    const MCPencilMarkWord *box = &fill->used[(dimensionality * 2 + topology->cellBox[cell]) * wordCount];
+    uint count = 0;
+    for (uint i = 0; i < wordCount; i++) {
+        MCPencilMarkWord candidates = ~(row[i] | column[i] | box[i]);
+        if (excluded != NULL) { candidates &= ~excluded[i]; }
+        uint bitCount = dimensionality - i * MCFillWordBits;
+        if (bitCount < MCFillWordBits) { candidates &= ((MCPencilMarkWord)1 << bitCount) - 1; }
+        fill->candidates[i] = candidates;
+        count += __builtin_popcountll(candidates);
+    }
+    return count;
+}
+
+// Picks one of the count numbers in fill->candidates at random.
+static uint pickCandidate(MCGridFill *fill, MCRandomState *random, uint count)
+{
+    uint skip = randomBelow(random, count);
+    for (uint i = 0; i < fill->wordCount; i++) {
+        MCPencilMarkWord candidates = fill->candidates[i];
+        uint bitCount = __builtin_popcountll(candidates);
+        if (skip >= bitCount) {
+            skip -= bitCount;
+            continue;
+        }
+        for (; skip > 0; skip--) { candidates &= candidates - 1; }
+        return i * MCFillWordBits + __builtin_ctzll(candidates) + 1;
+    }
+    return 0;
+}
+
+#pragma mark Filling
+
+// Returns the position in emptyCells of the empty cell with the fewest candidates, ties broken at random, and writes
+// how many it has to count.
+static uint chooseCell(MCGridFill *fill, MCRandomState *random, uint *count)
+{
+    uint bestCount = UINT_MAX, tieCount = 0;
+    for (uint i = 0; i < fill->emptyCount; i++) {
+        uint candidateCount = fill->candidateCounts[fill->emptyCells[i]];
+        if (candidateCount < bestCount) {
+            bestCount = candidateCount;
+            tieCount = 0;
+            if (candidateCount == 0) { break; }
+        }
+        tieCount += candidateCount == bestCount;
+    }
+    *count = bestCount;
+    if (bestCount == 0) { return 0; }
+    uint tie = randomBelow(random, tieCount);
+    for (uint i = 0; ; i++) {
+        if (fill->candidateCounts[fill->emptyCells[i]] == bestCount && tie-- == 0) { return i; }
+    }
+}
+
+// Cells leave emptyCells by swapping with the last empty one, which dropStep undoes in reverse order.
+static void pushStep(MCGridFill *fill, uint position)
+{
+    MCFillStep *step = &fill->steps[fill->stepCount];
+    uint last = --fill->emptyCount;
+    step->cell = fill->emptyCells[position];
+    step->position = position;
+    step->number = 0;
+    fill->emptyCells[position] = fill->emptyCells[last];
+    fill->emptyCells[last] = step->cell;
+    memset(&fill->tried[fill->stepCount * fill->wordCount], 0, sizeof(MCPencilMarkWord) * fill->wordCount);
+    fill->stepCount++;
+}
+
+static void dropStep(MCGridFill *fill)
+{
+    MCFillStep *step = &fill->steps[--fill->stepCount];
+    uint last = fill->emptyCount++;
+    fill->emptyCells[last] = fill->emptyCells[step->position];
+    fill->emptyCells[step->position] = step->cell;
+    fill->candidateCounts[step->cell] = findCandidates(fill, step->cell, NULL);
+}
+
+// Replaces the number placed by the last step with one it hasn't tried yet. Returns 0 if there are none left.
+static int tryNextNumber(MCGridFill *fill, MCRandomState *random)
+{
+    MCFillStep *step = &fill->steps[fill->stepCount - 1];
+    MCPencilMarkWord *tried = &fill->tried[(fill->stepCount - 1) * fill->wordCount];
+    if (step->number != 0) {
+        setNumber(fill, step->cell, step->number, 0);
+        tried[(step->number - 1) / MCFillWordBits] |= (MCPencilMarkWord)1 << ((step->number - 1) % MCFillWordBits);
+        step->number = 0;
+    }
+    uint count = findCandidates(fill, step->cell, tried);
+    if (count == 0) { return 0; }
+    step->number = pickCandidate(fill, random, count);
+    setNumber(fill, step->cell, step->number, 1);
+    return 1;
+}
+
+// Returns 0 if the fill had to give up.
+static int fillGrid(MCGridFill *fill, MCRandomState *random)
+{
+    clearGridFill(fill);
+    uint placementCount = 0, placementLimit = fill->topology->cellCount * MCFillPlacementsPerCell;
+    while (fill->emptyCount > 0) {
+        uint count;
+        uint position = chooseCell(fill, random, &count);
+        if (count > 0) { pushStep(fill, position); }
+        else if (fill->stepCount == 0) { return 0; }
+
+        // A cell with nothing left means backing up to the last cell with a number it hasn't tried.
+        while (!tryNextNumber(fill, random)) {
+            dropStep(fill);
+            if (fill->stepCount == 0) { return 0; }
+        }
+        if (++placementCount > placementLimit) { return 0; }
+    }
+    return 1;
+}
+
+#pragma mark Shuffling a Fixed Grid
+
+// Every row of the fixed grid is the one above shifted by a box width, or by one more at the start of a band.
+static void shuffleFixedGrid(const MCSudokuSolveContext *context, MCRandomState *random, uint *grid)
+{
+    uint order = context->order, dimensionality = context->dimensionality;
+    uint *fixedGrid = malloc(sizeof(uint) * context->cellCount);
+    for (uint row = 0; row < dimensionality; row++) {
+        for (uint column = 0; column < dimensionality; column++) {
+            uint number = ((row % order) * order + row / order + column) % dimensionality;
+            fixedGrid[row * dimensionality + column] = number + 1;
+        }
+    }
+    MCSudokuTransform *transform = createTransform(order);
+    randomizeTransform(transform, random);
+    applyTransform(transform, fixedGrid, grid);
+    destroyTransform(transform);
+    free(fixedGrid);
+}
+
+#pragma mark Public Functions
+
+void fillSolutionGrid(const MCSudokuSolveContext *context, MCRandomState *random, uint *grid)
+{
+    MCGridFill fill;
+    createGridFill(&fill, context, grid);
+    int isFilled = 0;
+    for (uint i = 0; i < MCFillAttemptCount && !isFilled && context->order <= MCFillMaxOrder; i++) {
+        isFilled = fillGrid(&fill, random);
+    }
+    destroyGridFill(&fill);
+    if (!isFilled) { shuffleFixedGrid(context, random, grid); }
+}
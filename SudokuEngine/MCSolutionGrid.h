@@ -0,0 +1,24 @@
+//
+//  MCSolutionGrid.h
+//  Sudoku++
+//
+//  Created by Maarut Chandegra on 17/10/2026.
+//  Copyright © 2026 Maarut Chandegra. All rights reserved.
+//
+
+#ifndef MCSolutionGrid_h
+#define MCSolutionGrid_h
+
+#include "MCRandom.h"
+#include "MCSudokuEngine.h"
+
+// Builds completely filled, valid grids to make puzzles from, without going anywhere near the solver. Cells are
+// filled one at a time, always the one with the fewest numbers left, with a number chosen at random from those left.
+// A fill that backtracks too often is started again, and orders too large for that to work in reasonable time fall
+// back to shuffling a fixed grid. The grids are spread widely but not exactly uniformly over every possible grid.
+
+// Fills grid, cellCount numbers, with a random solution grid of the context's order. Only the context's dimensions
+// and maps are used. The same random state always gives the same grid.
+void fillSolutionGrid(const MCSudokuSolveContext *context, MCRandomState *random, uint *grid);
+
+#endif /* MCSolutionGrid_h */
@@ -7,18 +7,136 @@
 //
 
 #include "MCSudokuEngine.h"
+#include "MCExactCover.h"
+#include "MCPencilMarkKernels.h"
+#include "MCRandom.h"
+#include "MCSolutionGrid.h"
+#include "MCSudokuTopology.h"
+#include "MCSudokuTransform.h"
+#include "MCTaskScheduler.h"
 #include <stdlib.h>
-#include <dispatch/dispatch.h>
+#include <stdatomic.h>
 #include <string.h>
 #include <limits.h>
+#include <time.h>
 
 #pragma mark Typedefs
 
-// This shouldn't really be a type, but it sits in MCSudokuSolveContext.opaque.
-typedef struct _MCSudokuSolveContextStopSolve {
-    char stopSolve;
-    dispatch_semaphore_t lock;
-} MCSudokuSolveContextStopSolve;
+// Guesses shallower than MCSearchSplitDepth are always split into tasks, deeper ones only while a thread is idle.
+#define MCSearchSplitDepth      2
+#define MCSearchIdleSplitDepth  8
+
+// The number of independent attempts made at removing numbers when generating a puzzle.
+#define MCRemovalAttemptCount   20
+
+// Solves with a time limit read the clock once every this many steps, which must be a power of 2.
+#define MCDeadlineCheckInterval 16
+
+// A single change made while backtracking in place. Placements record the cell that was filled, everything else
+// records the previous value of a pencil mark word.
+typedef struct _MCSudokuTrailEntry {
+    uint index;
+    uint isPlacement;
+    MCPencilMarkWord pencilMarks;
+} MCSudokuTrailEntry;
+
+typedef struct _MCSudokuTrail {
+    MCSudokuTrailEntry *entries;
+    uint count;
+    uint capacity;
+} MCSudokuTrail;
+
+// A guess being tried in place. The board is rolled back to mark before each of its candidates is tried.
+typedef struct _MCSudokuGuess {
+    uint mark;
+    uint difficultyScore;
+    uint guessSquare;
+    uint nextPencilMark;            // The first candidate not yet tried.
+    MCRandomState random;           // The random state when the guess was made.
+} MCSudokuGuess;
+
+// The guesses a backtracking context is inside of, innermost last, each with the candidates it has to try.
+typedef struct _MCSudokuGuessStack {
+    MCSudokuGuess *guesses;
+    MCPencilMarkWord *candidates;   // candidates[capacity][pencilMarkWordCount]
+    uint count;
+    uint capacity;
+} MCSudokuGuessStack;
+
+// Set once to stop a solve, to the MCSolveStatus it stopped with. Checking a token also checks its parents, so
+// cancelling a solve reaches every search and branch working on it.
+typedef struct _MCCancellationToken {
+    atomic_int isCancelled;
+    const struct _MCCancellationToken *parent;
+    struct _MCSudokuAllowance *allowance;   // The budget being spent, passed on to every token under this one.
+} MCCancellationToken;
+
+// What a solve has spent of its budget. Running out cancels token, the one belonging to the solve.
+typedef struct _MCSudokuAllowance {
+    MCCancellationToken *token;
+    double deadline;                // On the clock read by currentTime, 0 for no limit.
+    uint guessLimit;                // 0 for no limit.
+    atomic_uint guessCount;
+} MCSudokuAllowance;
+
+// Shared by every branch spawned from the first guess of a solve.
+typedef struct _MCSudokuSearch {
+    MCSudokuSolveContext *context;
+    MCTaskGroup branches;
+    MCCancellationToken cancellation;   // Cancelled once a second solution turns up.
+    pthread_mutex_t lock;
+    uint solutionCount;
+    uint difficultyScore;
+    atomic_uint guessCount;
+    atomic_uint allocationCount;
+    MCSolutionCallback callback;        // Set when enumerating, each solution is passed to it instead of being graded.
+    void *callbackInfo;
+    uint limit;                         // The most solutions to pass to callback.
+} MCSudokuSearch;
+
+// A guess waiting to be tried by whichever worker picks it up. It owns a copy of the board and pencil marks from
+// before the guess was made, allocated along with it.
+typedef struct _MCSudokuBranch {
+    MCSudokuSearch *search;
+    uint *board;
+    MCPencilMarkWord *pencilMarks;
+    MCRandomState random;
+    uint difficultyScore;
+    uint guessDepth;
+    uint guessSquare;
+    uint number;
+} MCSudokuBranch;
+
+// The techniques that remember which units they have already found nothing in.
+typedef enum _MCSudokuTechnique {
+    MCSudokuTechniqueHiddenSingle,
+    MCSudokuTechniquePencilMarks,
+    MCSudokuTechniqueHiddenPencilMarks,
+    MCSudokuTechniqueBoxCrossSection,
+    MCSudokuTechniqueCount
+} MCSudokuTechnique;
+
+// Tracks what has changed since each technique last looked at the board. Units are numbered box, row, column for
+// each index in turn, the order the techniques scan them in. A unit's version goes up whenever one of its cells
+// changes, so a technique that found nothing in a unit can skip it until the version moves on.
+typedef struct _MCSudokuPropagation {
+    uint *unitVersions;             // unitVersions[dimensionality * 3]
+    uint *checkedVersions;          // checkedVersions[MCSudokuTechniqueCount][dimensionality * 3]
+    uint *singles;                  // Empty cells that have come down to one pencil mark, in the order they did.
+    uint singleHead;
+    uint singleTail;
+    uint emptyCellCount;
+    int hasContradiction;           // An empty cell has run out of pencil marks.
+} MCSudokuPropagation;
+
+// The sizes of a board, as used by the solve loop. See shapeForOrder.
+typedef struct _MCSudokuShape {
+    uint order;
+    uint dimensionality;
+    uint cellCount;
+    uint neighbourCount;
+    uint wordCount;
+} MCSudokuShape;
 
 typedef struct _MCPencilMarkSet {
     uint pencilMark;
@@ -26,6 +144,54 @@ typedef struct _MCPencilMarkSet {
     uint *indexes;
 } MCPencilMarkSet;
 
+// Working space for the techniques, allocated along with the solve state so the solve loop itself never allocates.
+// pencilMarkMap relies on being zeroed when it is allocated and on each use clearing what the last one wrote.
+typedef struct _MCSudokuScratch {
+    const MCPencilMarkKernels *kernels;
+    MCPencilMarkSet *pencilMarkMap;     // pencilMarkMap[maxNumberForPencils], each with room for dimensionality cells
+    MCPencilMarkWord *unitPencilMarks;  // unitPencilMarks[pencilMarkWordCount][dimensionality]
+    uint8_t *pencilMarkCounts;          // pencilMarkCounts[cellCount], for orders with one word per cell
+    uint *indexes;                      // indexes[dimensionality]
+    uint *cellSet;                      // cellSet[dimensionality]
+    uint *indexesToModify;              // indexesToModify[dimensionality]
+    uint *cells;                        // cells[cellCount]
+    char *seenNumbers;                  // seenNumbers[dimensionality]
+} MCSudokuScratch;
+
+// This shouldn't really be a type, but it sits in MCSudokuSolveContext.opaque.
+typedef struct _MCSudokuSolveContextState {
+    MCCancellationToken cancellation;
+    MCSudokuAllowance allowance;    // The context's budget, only used by the states of contexts.
+    MCSudokuSearch *search;         // Set, along with trail and guesses, for contexts working on a branch.
+    MCSudokuTrail *trail;
+    MCSudokuGuessStack *guesses;
+    MCSudokuPropagation propagation;
+    MCSudokuScratch scratch;
+    uint order;
+    uint guessDepth;
+    uint guessCount;                // Guesses made on this branch, added to the search when it finishes.
+    uint allocationCount;           // Heap allocations made while solving, added up the same way as guessCount.
+    uint stepCount;                 // Times shouldStopSolve has been asked, for spacing out reads of the clock.
+    MCRandomState random;           // Breaks ties between equally good guess squares.
+    struct _MCSudokuSolveContextState *counting;    // Used by countSolutions, NULL until it is first needed.
+} MCSudokuSolveContextState;
+
+typedef struct _MCNumberRemoval {
+    MCSudokuSolveContext *context;
+    MCPuzzleDifficulty expectedDifficulty;
+    uint targetDifficulty;
+    uint *allIndexes;
+} MCNumberRemoval;
+
+// One of several independent runs at removing numbers, each with its own random choices. The best result of each
+// is kept so they can be compared in a fixed order once they have all finished.
+typedef struct _MCRemovalAttempt {
+    MCNumberRemoval *removal;
+    uint64_t seed;
+    uint hardestDifficulty;
+    uint *targetProblem;
+} MCRemovalAttempt;
+
 #pragma mark Debug Logging
 
 #ifdef DEBUG
@@ -90,217 +256,589 @@ void MCLogContext(MCSudokuSolveContext *context, MCSudokuSolveContextAspect aspe
 
 #endif // DEBUG
 
-#pragma mark Single Reduction
+#pragma mark Shapes
+
+#define MCPencilMarkWordBits (sizeof(MCPencilMarkWord) * CHAR_BIT)
+
+// Everything the solve loop does is written once against an MCSudokuShape and always inlined, so a solver built with
+// shapeForOrder and a constant order gets its own copy with constant loop bounds, divisions by constants and no word
+// loops. Anything else goes through shapeForContext and works for every order.
+#define MCShapeInline static inline __attribute__((always_inline))
+
+MCShapeInline MCSudokuShape shapeForOrder(uint order)
+{
+    uint dimensionality = order * order;
+    MCSudokuShape shape = {
+        order,
+        dimensionality,
+        dimensionality * dimensionality,
+        order * (3 * order - 2) - 1,
+        (dimensionality + MCPencilMarkWordBits - 1) / MCPencilMarkWordBits
+    };
+    return shape;
+}
+
+static inline MCSudokuShape shapeForContext(MCSudokuSolveContext *context)
+{
+    MCSudokuShape shape = {
+        context->order,
+        context->dimensionality,
+        context->cellCount,
+        context->neighbourCount,
+        context->pencilMarkWordCount
+    };
+    return shape;
+}
+
+#pragma mark Pencil Mark Bitmasks
+
+MCShapeInline MCPencilMarkWord *pencilMarksForCell(MCSudokuSolveContext *context, MCSudokuShape shape, uint index)
+{
+    return &context->pencilMarks[index * shape.wordCount];
+}
+
+static inline int hasPencilMark(const MCPencilMarkWord *pencilMarks, uint pencilMark)
+{
+    return (pencilMarks[pencilMark / MCPencilMarkWordBits] >> (pencilMark % MCPencilMarkWordBits)) & 1;
+}
+
+static inline void clearPencilMark(MCPencilMarkWord *pencilMarks, uint pencilMark)
+{
+    pencilMarks[pencilMark / MCPencilMarkWordBits] &= ~((MCPencilMarkWord)1 << (pencilMark % MCPencilMarkWordBits));
+}
+
+MCShapeInline uint countPencilMarks(MCSudokuShape shape, const MCPencilMarkWord *pencilMarks)
+{
+    uint count = 0;
+    for (uint i = 0; i < shape.wordCount; i++) { count += __builtin_popcountll(pencilMarks[i]); }
+    return count;
+}
+
+// Returns the number the cell must hold if exactly one pencil mark is set, otherwise 0.
+MCShapeInline uint singlePencilMark(MCSudokuShape shape, const MCPencilMarkWord *pencilMarks)
+{
+    uint number = 0;
+    for (uint i = 0; i < shape.wordCount; i++) {
+        MCPencilMarkWord word = pencilMarks[i];
+        if (word == 0) { continue; }
+        if (number != 0 || (word & (word - 1)) != 0) { return 0; }
+        number = i * MCPencilMarkWordBits + __builtin_ctzll(word) + 1;
+    }
+    return number;
+}
+
+MCShapeInline int pencilMarksEqual(MCSudokuShape shape, const MCPencilMarkWord *lhs, const MCPencilMarkWord *rhs)
+{
+    for (uint i = 0; i < shape.wordCount; i++) {
+        if (lhs[i] != rhs[i]) { return 0; }
+    }
+    return 1;
+}
+
+static inline void setAllPencilMarks(MCSudokuSolveContext *context, MCPencilMarkWord *pencilMarks)
+{
+    for (uint i = 0; i < context->pencilMarkWordCount; i++) {
+        uint bits = context->maxNumberForPencils - i * MCPencilMarkWordBits;
+        pencilMarks[i] = bits >= MCPencilMarkWordBits ? ~(MCPencilMarkWord)0 : ((MCPencilMarkWord)1 << bits) - 1;
+    }
+}
+
+#pragma mark Cancellation
+
+// Relaxed loads are enough, cancelling only ever sets the flag and a solve that reads it a few steps late does no harm.
+static void initCancellationToken(MCCancellationToken *token, const MCCancellationToken *parent)
+{
+    atomic_init(&token->isCancelled, 0);
+    token->parent = parent;
+    token->allowance = parent != NULL ? parent->allowance : NULL;
+}
 
-static int reduceSingle(MCSudokuSolveContext *context)
+// The first reason a token is cancelled with is the one that sticks.
+static void cancelToken(MCCancellationToken *token, MCSolveStatus reason)
 {
+    int isCancelled = 0;
+    atomic_compare_exchange_strong_explicit(&token->isCancelled, &isCancelled, reason, memory_order_relaxed,
+        memory_order_relaxed);
+}
+
+// Returns the reason the token, or the nearest of its parents to be cancelled, was cancelled with, or 0.
+static int isCancelled(const MCCancellationToken *token)
+{
+    for (; token != NULL; token = token->parent) {
+        int reason = atomic_load_explicit(&token->isCancelled, memory_order_relaxed);
+        if (reason != 0) { return reason; }
+    }
+    return 0;
+}
+
+#pragma mark Budgets
+
+static double currentTime(void)
+{
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+// Starts spending budget. Tokens only look for an allowance when the budget has a limit, so unlimited solves never
+// pay for checking it.
+static void startAllowance(MCSudokuAllowance *allowance, MCCancellationToken *token, MCSolveBudget budget)
+{
+    allowance->token = token;
+    allowance->deadline = budget.seconds > 0 ? currentTime() + budget.seconds : 0;
+    allowance->guessLimit = budget.guessLimit;
+    atomic_store_explicit(&allowance->guessCount, 0, memory_order_relaxed);
+    token->allowance = budget.seconds > 0 || budget.guessLimit > 0 ? allowance : NULL;
+}
+
+static void checkDeadline(MCSudokuAllowance *allowance)
+{
+    if (allowance->deadline > 0 && currentTime() >= allowance->deadline) {
+        cancelToken(allowance->token, MCSolveStatusOverBudget);
+    }
+}
+
+static void spendGuess(MCSudokuAllowance *allowance)
+{
+    if (allowance == NULL || allowance->guessLimit == 0) { return; }
+    if (atomic_fetch_add_explicit(&allowance->guessCount, 1, memory_order_relaxed) >= allowance->guessLimit) {
+        cancelToken(allowance->token, MCSolveStatusOverBudget);
+    }
+}
+
+#pragma mark Allocation
+
+// Allocations made during a solve go through these so they can be counted.
+static void *allocateForSolve(MCSudokuSolveContextState *state, size_t size)
+{
+    state->allocationCount++;
+    return malloc(size);
+}
+
+static void *reallocateForSolve(MCSudokuSolveContextState *state, void *pointer, size_t size)
+{
+    state->allocationCount++;
+    return realloc(pointer, size);
+}
+
+#pragma mark Propagation
+
+static inline uint boxUnit(uint box)         { return box * 3;       }
+static inline uint rowUnit(uint row)         { return row * 3 + 1;   }
+static inline uint columnUnit(uint column)   { return column * 3 + 2; }
+
+static inline MCSudokuPropagation *propagationForContext(MCSudokuSolveContext *context)
+{
+    return &((MCSudokuSolveContextState *)context->opaque)->propagation;
+}
+
+static void createPropagation(MCSudokuSolveContextState *state, MCSudokuSolveContext *context)
+{
+    MCSudokuPropagation *propagation = &state->propagation;
+    uint unitCount = context->dimensionality * 3;
+    propagation->unitVersions = allocateForSolve(state,
+        sizeof(uint) * (unitCount * (1 + MCSudokuTechniqueCount) + context->cellCount));
+    propagation->checkedVersions = propagation->unitVersions + unitCount;
+    propagation->singles = propagation->checkedVersions + unitCount * MCSudokuTechniqueCount;
+}
+
+static void destroyPropagation(MCSudokuPropagation *propagation)
+{
+    free(propagation->unitVersions);
+}
+
+static inline void changeCell(MCSudokuSolveContext *context, uint index)
+{
+    uint *unitVersions = propagationForContext(context)->unitVersions;
+    MCSudokuTopology *topology = context->topology;
+    unitVersions[boxUnit(topology->cellBox[index])]++;
+    unitVersions[rowUnit(topology->cellRow[index])]++;
+    unitVersions[columnUnit(topology->cellColumn[index])]++;
+}
+
+static inline void notePencilMarkCount(MCSudokuPropagation *propagation, uint index, uint count)
+{
+    if (count == 0) { propagation->hasContradiction = 1; }
+    else if (count == 1) { propagation->singles[propagation->singleTail++] = index; }
+}
+
+// Called after an empty cell loses pencil marks.
+MCShapeInline void checkPencilMarkCount(MCSudokuSolveContext *context, MCSudokuShape shape, uint index)
+{
+    if (context->board[index] != 0) { return; }
+    notePencilMarkCount(propagationForContext(context), index,
+        countPencilMarks(shape, pencilMarksForCell(context, shape, index)));
+}
+
+// Starts tracking from the context's current board and pencil marks, with every unit still to be checked.
+static void beginPropagation(MCSudokuSolveContext *context)
+{
+    MCSudokuShape shape = shapeForContext(context);
+    MCSudokuPropagation *propagation = propagationForContext(context);
+    uint unitCount = context->dimensionality * 3;
+    for (uint i = 0; i < unitCount; i++) { propagation->unitVersions[i] = 1; }
+    memset(propagation->checkedVersions, 0, sizeof(uint) * unitCount * MCSudokuTechniqueCount);
+    propagation->singleHead = 0;
+    propagation->singleTail = 0;
+    propagation->emptyCellCount = 0;
+    propagation->hasContradiction = 0;
+    uint8_t *counts = NULL;
+    if (context->pencilMarkWordCount == 1) {
+        MCSudokuScratch *scratch = &((MCSudokuSolveContextState *)context->opaque)->scratch;
+        counts = scratch->pencilMarkCounts;
+        scratch->kernels->count(context->pencilMarks, context->cellCount, counts);
+    }
     for (uint i = 0; i < context->cellCount; i++) {
-        uint pencilMarkCount = 0;
-        uint number = 0;
-        if (context->board[i] > 0) { continue; }
-        for (uint j = 0; j < context->maxNumberForPencils; j++) {
-            if (context->pencilMarks[i][j]) {
-                pencilMarkCount++;
-                number = j + 1;
-                if (pencilMarkCount > 1) {
-                    break;
-                }
-            }
+        if (context->board[i] != 0) { continue; }
+        propagation->emptyCellCount++;
+        notePencilMarkCount(propagation, i,
+            counts != NULL ? counts[i] : countPencilMarks(shape, pencilMarksForCell(context, shape, i)));
+    }
+}
+
+static inline int isUnitChecked(MCSudokuPropagation *propagation, MCSudokuTechnique technique, uint unitCount,
+    uint unit, uint version)
+{
+    return propagation->checkedVersions[technique * unitCount + unit] == version;
+}
+
+static inline void setUnitChecked(MCSudokuPropagation *propagation, MCSudokuTechnique technique, uint unitCount,
+    uint unit, uint version)
+{
+    propagation->checkedVersions[technique * unitCount + unit] = version;
+}
+
+#pragma mark Scratch Space
+
+static inline MCSudokuScratch *scratchForContext(MCSudokuSolveContext *context)
+{
+    return &((MCSudokuSolveContextState *)context->opaque)->scratch;
+}
+
+// Everything is carved out of one zeroed block.
+static void createScratch(MCSudokuSolveContextState *state, MCSudokuSolveContext *context)
+{
+    MCSudokuScratch *scratch = &state->scratch;
+    uint dimensionality = context->dimensionality, mapSize = context->maxNumberForPencils;
+    size_t size = sizeof(MCPencilMarkSet) * mapSize + sizeof(MCPencilMarkWord) * context->pencilMarkWordCount *
+        dimensionality + sizeof(uint) * (mapSize * dimensionality + dimensionality * 3 + context->cellCount) +
+        context->cellCount + dimensionality;
+    scratch->kernels = pencilMarkKernels();
+    scratch->pencilMarkMap = memset(allocateForSolve(state, size), 0, size);
+    scratch->unitPencilMarks = (MCPencilMarkWord *)(scratch->pencilMarkMap + mapSize);
+    uint *indexes = (uint *)(scratch->unitPencilMarks + context->pencilMarkWordCount * dimensionality);
+    for (uint i = 0; i < mapSize; i++) {
+        scratch->pencilMarkMap[i].pencilMark = i + 1;
+        scratch->pencilMarkMap[i].indexes = indexes + i * dimensionality;
+    }
+    scratch->indexes = indexes + mapSize * dimensionality;
+    scratch->cellSet = scratch->indexes + dimensionality;
+    scratch->indexesToModify = scratch->cellSet + dimensionality;
+    scratch->cells = scratch->indexesToModify + dimensionality;
+    scratch->pencilMarkCounts = (uint8_t *)(scratch->cells + context->cellCount);
+    scratch->seenNumbers = (char *)(scratch->pencilMarkCounts + context->cellCount);
+}
+
+static void destroyScratch(MCSudokuScratch *scratch)
+{
+    free(scratch->pencilMarkMap);
+}
+
+#pragma mark Trail
+
+// Everything that changes the board or pencil marks while solving goes through the functions below so that a
+// backtracking context can record the change and roll it back with undoTrail.
+
+static void pushTrailEntry(MCSudokuSolveContextState *state, uint index, uint isPlacement,
+    MCPencilMarkWord pencilMarks)
+{
+    MCSudokuTrail *trail = state->trail;
+    if (trail->count == trail->capacity) {
+        trail->capacity *= 2;
+        trail->entries = reallocateForSolve(state, trail->entries, sizeof(MCSudokuTrailEntry) * trail->capacity);
+    }
+    MCSudokuTrailEntry *entry = &trail->entries[trail->count++];
+    entry->index = index;
+    entry->isPlacement = isPlacement;
+    entry->pencilMarks = pencilMarks;
+}
+
+// Changes made before a context's first guess are never rolled back, so there's no need to record them.
+static inline int isRecordingTrail(MCSudokuSolveContextState *state)
+{
+    return state->trail != NULL && state->guesses->count > 0;
+}
+
+MCShapeInline void recordPencilMarkWord(MCSudokuSolveContext *context, uint word)
+{
+    MCSudokuSolveContextState *state = context->opaque;
+    if (isRecordingTrail(state)) { pushTrailEntry(state, word, 0, context->pencilMarks[word]); }
+}
+
+static void undoTrail(MCSudokuSolveContext *context, uint mark)
+{
+    MCSudokuTrail *trail = ((MCSudokuSolveContextState *)context->opaque)->trail;
+    MCSudokuPropagation *propagation = propagationForContext(context);
+    while (trail->count > mark) {
+        MCSudokuTrailEntry *entry = &trail->entries[--trail->count];
+        if (entry->isPlacement) {
+            context->board[entry->index] = 0;
+            propagation->emptyCellCount++;
+            changeCell(context, entry->index);
         }
-        if (pencilMarkCount == 1) {
-            context->board[i] = number;
-            for (uint j = 0; j < context->neighbourCount; j++) {
-                context->pencilMarks[context->neighbourMap[i][j]][number - 1] = 0;
-            }
+        else {
+            context->pencilMarks[entry->index] = entry->pencilMarks;
+            changeCell(context, entry->index / context->pencilMarkWordCount);
+        }
+    }
+    // Trails are only rolled back to just before a guess, when there were no singles left and no contradiction.
+    propagation->singleHead = 0;
+    propagation->singleTail = 0;
+    propagation->hasContradiction = 0;
+}
+
+MCShapeInline void removePencilMark(MCSudokuSolveContext *context, MCSudokuShape shape, uint index, uint pencilMark)
+{
+    uint word = index * shape.wordCount + pencilMark / MCPencilMarkWordBits;
+    MCPencilMarkWord bit = (MCPencilMarkWord)1 << (pencilMark % MCPencilMarkWordBits);
+    if (!(context->pencilMarks[word] & bit)) { return; }
+    recordPencilMarkWord(context, word);
+    context->pencilMarks[word] &= ~bit;
+    changeCell(context, index);
+    checkPencilMarkCount(context, shape, index);
+}
+
+// Clears every pencil mark in toRemove from the cell, returning whether anything was cleared.
+MCShapeInline int removePencilMarks(MCSudokuSolveContext *context, MCSudokuShape shape, uint index,
+    const MCPencilMarkWord *toRemove)
+{
+    int didChange = 0;
+    for (uint i = 0; i < shape.wordCount; i++) {
+        uint word = index * shape.wordCount + i;
+        if (context->pencilMarks[word] & toRemove[i]) {
+            recordPencilMarkWord(context, word);
+            context->pencilMarks[word] &= ~toRemove[i];
+            didChange = 1;
+        }
+    }
+    if (didChange) {
+        changeCell(context, index);
+        checkPencilMarkCount(context, shape, index);
+    }
+    return didChange;
+}
+
+MCShapeInline void placeNumber(MCSudokuSolveContext *context, MCSudokuShape shape, uint index, uint number)
+{
+    MCSudokuSolveContextState *state = context->opaque;
+    if (isRecordingTrail(state)) { pushTrailEntry(state, index, 1, 0); }
+    context->board[index] = number;
+    propagationForContext(context)->emptyCellCount--;
+    changeCell(context, index);
+    for (uint j = 0; j < shape.neighbourCount; j++) {
+        removePencilMark(context, shape, context->neighbourMap[index][j], number - 1);
+    }
+}
+
+#pragma mark Single Reduction
+
+// Takes the next cell off the singles queue. Cells that have been filled or emptied since they were queued are
+// skipped. The order singles are placed in makes no difference to how many of them there are.
+MCShapeInline int reduceSingle(MCSudokuSolveContext *context, MCSudokuShape shape)
+{
+    MCSudokuPropagation *propagation = propagationForContext(context);
+    while (propagation->singleHead < propagation->singleTail) {
+        uint index = propagation->singles[propagation->singleHead++];
+        if (context->board[index] > 0) { continue; }
+        uint number = singlePencilMark(shape, pencilMarksForCell(context, shape, index));
+        if (number != 0) {
+            placeNumber(context, shape, index, number);
             return 1;
         }
     }
     return 0;
 }
 
-static void mapPencilMarkToCells(MCSudokuSolveContext *context, uint *region, MCPencilMarkSet *map)
+MCShapeInline void mapPencilMarkToCells(MCSudokuSolveContext *context, MCSudokuShape shape, uint *region,
+    MCPencilMarkSet *map)
 {
-    for (uint i = 0; i < context->maxNumberForPencils; i++) {
+    for (uint i = 0; i < shape.dimensionality; i++) {
         memset(map[i].indexes, 0, sizeof(uint) * map[i].countIndexes);
         map[i].countIndexes = 0;
     }
     
-    for (uint i = 0; i < context->dimensionality; i++) {
-        for (uint j = 0; j < context->maxNumberForPencils; j++) {
-            uint num = context->board[region[i]];
-            if (num == 0 && context->pencilMarks[region[i]][j]) {
+    for (uint i = 0; i < shape.dimensionality; i++) {
+        if (context->board[region[i]] != 0) { continue; }
+        MCPencilMarkWord *pencilMarks = pencilMarksForCell(context, shape, region[i]);
+        for (uint w = 0; w < shape.wordCount; w++) {
+            for (MCPencilMarkWord word = pencilMarks[w]; word; word &= word - 1) {
+                uint j = w * MCPencilMarkWordBits + __builtin_ctzll(word);
                 map[j].indexes[map[j].countIndexes++] = region[i];
             }
         }
     }
 }
 
-static int reduceHiddenSingleForRegion(MCSudokuSolveContext *context, uint *region, MCPencilMarkSet *map)
+// Places the lowest number that only one empty cell in the region can hold. The region's pencil marks are gathered a
+// word at a time so each word can be reduced in one go.
+MCShapeInline int reduceHiddenSingleForRegion(MCSudokuSolveContext *context, MCSudokuShape shape, uint *region)
 {
-    int didChange = 0;
-    
-    mapPencilMarkToCells(context, region, map);
+    uint dimensionality = shape.dimensionality, wordCount = shape.wordCount;
+    MCSudokuScratch *scratch = scratchForContext(context);
+    MCPencilMarkWord *unitPencilMarks = scratch->unitPencilMarks;
+    for (uint i = 0; i < dimensionality; i++) {
+        const MCPencilMarkWord *pencilMarks = pencilMarksForCell(context, shape, region[i]);
+        int isEmpty = context->board[region[i]] == 0;
+        for (uint w = 0; w < wordCount; w++) { unitPencilMarks[w * dimensionality + i] = isEmpty ? pencilMarks[w] : 0; }
+    }
     
-    for (uint i = 0; i < context->maxNumberForPencils; i++) {
-        if (map[i].countIndexes == 1) {
-            uint index = map[i].indexes[0];
-            context->board[index] = map[i].pencilMark;
-            didChange = 1;
-            for (uint j = 0; j < context->neighbourCount; j++) {
-                context->pencilMarks[context->neighbourMap[index][j]][i] = 0;
+    for (uint w = 0; w < wordCount; w++) {
+        MCPencilMarkWord *words = unitPencilMarks + w * dimensionality, seen, seenTwice;
+        scratch->kernels->reduce(words, dimensionality, &seen, &seenTwice);
+        MCPencilMarkWord singles = seen & ~seenTwice;
+        if (singles == 0) { continue; }
+        MCPencilMarkWord single = singles & -singles;
+        for (uint i = 0; i < dimensionality; i++) {
+            if (words[i] & single) {
+                placeNumber(context, shape, region[i], w * MCPencilMarkWordBits + __builtin_ctzll(singles) + 1);
+                return 1;
             }
-            break;
         }
     }
-    
-    return didChange;
+    return 0;
 }
 
-static int reduceHiddenSingle(MCSudokuSolveContext *context)
+MCShapeInline int reduceHiddenSingleForUnit(MCSudokuSolveContext *context, MCSudokuShape shape, uint unit, uint *region)
 {
-    int didChange = 0;
-    MCPencilMarkSet *pencilMarkSet = malloc(sizeof(MCPencilMarkSet) * context->maxNumberForPencils);
-    for (uint i = 0; i < context->maxNumberForPencils; i++) {
-        pencilMarkSet[i].pencilMark = i + 1;
-        pencilMarkSet[i].countIndexes = 0;
-        pencilMarkSet[i].indexes = malloc(sizeof(uint) * context->maxNumberForPencils);
-    }
-    
-    for (uint i = 0; i < context->dimensionality; i++) {
-        // boxes
-        if (reduceHiddenSingleForRegion(context, context->boxMap[i], pencilMarkSet)) {
-            didChange = 1;
-            break;
-        }
-        // rows
-        if (reduceHiddenSingleForRegion(context, context->rowMap[i], pencilMarkSet)) {
-            didChange = 1;
-            break;
-        }
-        // columns
-        if (reduceHiddenSingleForRegion(context, context->columnMap[i], pencilMarkSet)) {
-            didChange = 1;
-            break;
-        }
-    }
-    
-    for (uint i = 0; i < context->maxNumberForPencils; i++) { free(pencilMarkSet[i].indexes); }
-    free(pencilMarkSet);
-    
-    return didChange;
+    MCSudokuPropagation *propagation = propagationForContext(context);
+    uint unitCount = shape.dimensionality * 3, version = propagation->unitVersions[unit];
+    if (isUnitChecked(propagation, MCSudokuTechniqueHiddenSingle, unitCount, unit, version)) { return 0; }
+    if (reduceHiddenSingleForRegion(context, shape, region)) { return 1; }
+    setUnitChecked(propagation, MCSudokuTechniqueHiddenSingle, unitCount, unit, version);
+    return 0;
 }
 
-#pragma mark Pencil Mark Reduction
-
-static MCPencilMarkSet *createPencilMarkMap(MCSudokuSolveContext *context)
+MCShapeInline int reduceHiddenSingle(MCSudokuSolveContext *context, MCSudokuShape shape)
 {
-    MCPencilMarkSet *pencilMarkSet = malloc(sizeof(MCPencilMarkSet) * context->maxNumberForPencils);
-    for (int i = 0; i < context->maxNumberForPencils; i++) {
-        pencilMarkSet[i].pencilMark = i + 1;
-        pencilMarkSet[i].countIndexes = 0;
-        pencilMarkSet[i].indexes = malloc(sizeof(uint) * context->maxNumberForPencils);
+    for (uint i = 0; i < shape.dimensionality; i++) {
+        if (reduceHiddenSingleForUnit(context, shape, boxUnit(i), context->boxMap[i]) ||
+            reduceHiddenSingleForUnit(context, shape, rowUnit(i), context->rowMap[i]) ||
+            reduceHiddenSingleForUnit(context, shape, columnUnit(i), context->columnMap[i])) {
+            return 1;
+        }
     }
-    return pencilMarkSet;
+    return 0;
 }
 
-static void destroyPencilMarkMap(MCSudokuSolveContext *context, MCPencilMarkSet *pencilMarkMap)
+// Places singles until there are none left, the board is full or a cell has run out of pencil marks. Naked singles
+// go before hidden ones and each placement is scored as though it were a pass of its own, so the score is the same as
+// placing them one at a time. Returns the score for everything placed.
+MCShapeInline uint reduceSingles(MCSudokuSolveContext *context, MCSudokuShape shape)
 {
-    for (int i = 0; i < context->maxNumberForPencils; i++) {
-        free(pencilMarkMap[i].indexes);
+    MCSudokuPropagation *propagation = propagationForContext(context);
+    uint score = 0;
+    while (propagation->emptyCellCount > 0 && !propagation->hasContradiction) {
+        if (reduceSingle(context, shape)) {
+            score += 1;
+            continue;
+        }
+        if (reduceHiddenSingle(context, shape)) { score += 10; }
+        else { break; }
     }
-    free(pencilMarkMap);
+    return score;
 }
 
-static uint countPencilMarks(char *pencilMarkSet, uint maxNumberForPencils)
-{
-    uint count = 0;
-    for (uint i = 0; i < maxNumberForPencils; i++) {
-        if (pencilMarkSet[i]) { count++; }
-    }
-    return count;
-}
+#pragma mark Pencil Mark Reduction
 
-static uint mapPencilMarksToCells(MCSudokuSolveContext *context, uint *region, uint *indexes)
+MCShapeInline uint mapPencilMarksToCells(MCSudokuSolveContext *context, MCSudokuShape shape, uint *region,
+    uint *indexes)
 {
     uint count = 0;
-    for (uint i = 0; i < context->dimensionality - 1; i++) {
+    for (uint i = 0; i < shape.dimensionality - 1; i++) {
         if (context->board[region[i]] != 0) { continue; }
-        char *pencilMarkSet;
-        memset(indexes, 0, sizeof(uint) * context->dimensionality);
+        MCPencilMarkWord *pencilMarkSet;
+        memset(indexes, 0, sizeof(uint) * shape.dimensionality);
         count = 0;
-        pencilMarkSet = context->pencilMarks[region[i]];
+        pencilMarkSet = pencilMarksForCell(context, shape, region[i]);
         indexes[count++] = region[i];
-        for (uint j = i + 1; j < context->dimensionality; j++) {
+        for (uint j = i + 1; j < shape.dimensionality; j++) {
             uint idx = region[j];
             if (context->board[idx] == 0 &&
-                !memcmp(pencilMarkSet, context->pencilMarks[idx], sizeof(char) * context->maxNumberForPencils)) {
+                pencilMarksEqual(shape, pencilMarkSet, pencilMarksForCell(context, shape, idx))) {
                 indexes[count++] = idx;
             }
         }
-        if (count == countPencilMarks(pencilMarkSet, context->maxNumberForPencils)) { break; }
+        if (count == countPencilMarks(shape, pencilMarkSet)) { break; }
     }
     return count;
 }
 
-static int reducePencilMarksForRegion(MCSudokuSolveContext *context, uint *region, uint *indexes)
+MCShapeInline int reducePencilMarksForRegion(MCSudokuSolveContext *context, MCSudokuShape shape, uint *region,
+    uint *indexes)
 {
     int didChange = 0;
-    uint count = mapPencilMarksToCells(context, region, indexes);
-    char *pencilMarkSet = context->pencilMarks[indexes[0]];
-    if (count == countPencilMarks(pencilMarkSet, context->maxNumberForPencils)) {
-        for (int j = 0; j < context->dimensionality; j++) {
+    uint count = mapPencilMarksToCells(context, shape, region, indexes);
+    MCPencilMarkWord *pencilMarkSet = pencilMarksForCell(context, shape, indexes[0]);
+    if (count == countPencilMarks(shape, pencilMarkSet)) {
+        for (int j = 0; j < shape.dimensionality; j++) {
             if (context->board[region[j]] == 0 &&
-                memcmp(pencilMarkSet, context->pencilMarks[region[j]], sizeof(char) * context->maxNumberForPencils)) {
-                for (int k = 0; k < context->maxNumberForPencils; k++) {
-                    if (pencilMarkSet[k] && context->pencilMarks[region[j]][k]) {
-                        context->pencilMarks[region[j]][k] = 0;
-                        didChange = 1;
-                    }
-                }
+                !pencilMarksEqual(shape, pencilMarkSet, pencilMarksForCell(context, shape, region[j]))) {
+                didChange |= removePencilMarks(context, shape, region[j], pencilMarkSet);
             }
         }
     }
     return didChange;
 }
 
-static int reducePencilMarks(MCSudokuSolveContext *context)
+MCShapeInline int reducePencilMarksForUnit(MCSudokuSolveContext *context, MCSudokuShape shape, uint unit,
+    uint *region, uint *indexes)
+{
+    MCSudokuPropagation *propagation = propagationForContext(context);
+    uint unitCount = shape.dimensionality * 3, version = propagation->unitVersions[unit];
+    if (isUnitChecked(propagation, MCSudokuTechniquePencilMarks, unitCount, unit, version)) { return 0; }
+    if (reducePencilMarksForRegion(context, shape, region, indexes)) { return 1; }
+    setUnitChecked(propagation, MCSudokuTechniquePencilMarks, unitCount, unit, version);
+    return 0;
+}
+
+MCShapeInline int reducePencilMarks(MCSudokuSolveContext *context, MCSudokuShape shape)
 {
     int didChange = 0;
-    uint *indexes = calloc(context->dimensionality, sizeof(uint));
-    for (uint i = 0; i < context->dimensionality; i++) {
-        if (reducePencilMarksForRegion(context, context->boxMap[i], indexes)) {
+    uint *indexes = scratchForContext(context)->indexes;
+    memset(indexes, 0, sizeof(uint) * shape.dimensionality);
+    for (uint i = 0; i < shape.dimensionality; i++) {
+        if (reducePencilMarksForUnit(context, shape, boxUnit(i), context->boxMap[i], indexes)) {
             didChange = 1;
             break;
         }
-        if (reducePencilMarksForRegion(context, context->columnMap[i], indexes)) {
+        if (reducePencilMarksForUnit(context, shape, columnUnit(i), context->columnMap[i], indexes)) {
             didChange = 1;
             break;
         }
-        if (reducePencilMarksForRegion(context, context->rowMap[i], indexes)) {
+        if (reducePencilMarksForUnit(context, shape, rowUnit(i), context->rowMap[i], indexes)) {
             didChange = 1;
             break;
         }
     }
-    free(indexes);
     return didChange;
 }
 
-static int reduceHiddenPencilMarksForRegion(MCSudokuSolveContext *context, uint *region,
+MCShapeInline int reduceHiddenPencilMarksForRegion(MCSudokuSolveContext *context, MCSudokuShape shape, uint *region,
     MCPencilMarkSet *pencilMarkSet, uint *cellSet)
 {
     int didChange = 0;
-    memset(cellSet, 0, sizeof(uint) * context->dimensionality);
-    mapPencilMarkToCells(context, region, pencilMarkSet);
+    memset(cellSet, 0, sizeof(uint) * shape.dimensionality);
+    mapPencilMarkToCells(context, shape, region, pencilMarkSet);
     
     uint currentCellSet = UINT_MAX;
     uint count = 0;
     
     // Invert the pencil mark to cells map
-    for (uint i = 0; i < context->maxNumberForPencils - 1; i++) {
+    for (uint i = 0; i < shape.dimensionality - 1; i++) {
         currentCellSet = i;
         cellSet[count++] = i;
-        for (uint j = i + 1; j < context->maxNumberForPencils; j++) {
-            if (!memcmp(pencilMarkSet[i].indexes, pencilMarkSet[j].indexes, sizeof(uint) * context->dimensionality)) {
+        for (uint j = i + 1; j < shape.dimensionality; j++) {
+            if (!memcmp(pencilMarkSet[i].indexes, pencilMarkSet[j].indexes, sizeof(uint) * shape.dimensionality)) {
                 cellSet[count++] = j;
             }
         }
@@ -310,9 +848,9 @@ static int reduceHiddenPencilMarksForRegion(MCSudokuSolveContext *context, uint
     }
     
     if (count > 0) {
-        uint *indexesToModify = calloc(sizeof(uint), context->dimensionality);
-        memcpy(indexesToModify, region, sizeof(uint) * context->dimensionality);
-        for (uint i = 0; i < context->dimensionality; i++) {
+        uint *indexesToModify = scratchForContext(context)->indexesToModify;
+        memcpy(indexesToModify, region, sizeof(uint) * shape.dimensionality);
+        for (uint i = 0; i < shape.dimensionality; i++) {
             if (context->board[indexesToModify[i]] != 0) {
                 indexesToModify[i] = -1;
             }
@@ -326,115 +864,122 @@ static int reduceHiddenPencilMarksForRegion(MCSudokuSolveContext *context, uint
             }
         }
         
-        for (uint i = 0; i < context->dimensionality; i++) {
+        for (uint i = 0; i < shape.dimensionality; i++) {
             if (indexesToModify[i] != -1) {
+                MCPencilMarkWord *pencilMarks = pencilMarksForCell(context, shape, indexesToModify[i]);
                 for (uint j = 0; j < count; j++) {
-                    if (context->pencilMarks[indexesToModify[i]][cellSet[j]]) {
-                        context->pencilMarks[indexesToModify[i]][cellSet[j]] = 0;
+                    if (hasPencilMark(pencilMarks, cellSet[j])) {
+                        removePencilMark(context, shape, indexesToModify[i], cellSet[j]);
                         didChange = 1;
                     }
                 }
             }
         }
-        free(indexesToModify);
     }
     return didChange;
 }
 
-static int reduceHiddenPencilMarks(MCSudokuSolveContext *context)
+MCShapeInline int reduceHiddenPencilMarksForUnit(MCSudokuSolveContext *context, MCSudokuShape shape, uint unit,
+    uint *region, MCPencilMarkSet *pencilMarkSet, uint *cellSet)
+{
+    MCSudokuPropagation *propagation = propagationForContext(context);
+    uint unitCount = shape.dimensionality * 3, version = propagation->unitVersions[unit];
+    if (isUnitChecked(propagation, MCSudokuTechniqueHiddenPencilMarks, unitCount, unit, version)) { return 0; }
+    if (reduceHiddenPencilMarksForRegion(context, shape, region, pencilMarkSet, cellSet)) { return 1; }
+    setUnitChecked(propagation, MCSudokuTechniqueHiddenPencilMarks, unitCount, unit, version);
+    return 0;
+}
+
+MCShapeInline int reduceHiddenPencilMarks(MCSudokuSolveContext *context, MCSudokuShape shape)
 {
     int didChange = 0;
-    MCPencilMarkSet *pencilMarkSet = createPencilMarkMap(context);
-    uint *cellSetToPencilMarks = malloc(sizeof(uint) * context->dimensionality);
+    MCPencilMarkSet *pencilMarkSet = scratchForContext(context)->pencilMarkMap;
+    uint *cellSetToPencilMarks = scratchForContext(context)->cellSet;
     
-    for (uint i = 0; i < context->dimensionality; i++) {
-        if (reduceHiddenPencilMarksForRegion(context, context->boxMap[i], pencilMarkSet, cellSetToPencilMarks)) {
+    for (uint i = 0; i < shape.dimensionality; i++) {
+        if (reduceHiddenPencilMarksForUnit(context, shape, boxUnit(i), context->boxMap[i], pencilMarkSet,
+            cellSetToPencilMarks)) {
             didChange = 1;
             break;
         }
-        if (reduceHiddenPencilMarksForRegion(context, context->rowMap[i], pencilMarkSet, cellSetToPencilMarks)) {
+        if (reduceHiddenPencilMarksForUnit(context, shape, rowUnit(i), context->rowMap[i], pencilMarkSet,
+            cellSetToPencilMarks)) {
             didChange = 1;
             break;
         }
-        if (reduceHiddenPencilMarksForRegion(context, context->columnMap[i], pencilMarkSet, cellSetToPencilMarks)) {
+        if (reduceHiddenPencilMarksForUnit(context, shape, columnUnit(i), context->columnMap[i], pencilMarkSet,
+            cellSetToPencilMarks)) {
             didChange = 1;
             break;
         }
     }
-    destroyPencilMarkMap(context, pencilMarkSet);
-    free(cellSetToPencilMarks);
     return didChange;
 }
 
-static inline int markupBoxCrossSection(MCSudokuSolveContext *context, uint box, uint pencilMark, uint *idxsToModify)
+MCShapeInline int markupBoxCrossSection(MCSudokuSolveContext *context, MCSudokuShape shape, uint box,
+    uint pencilMark, uint *idxsToModify)
 {
-    for (int j = 0; j < context->dimensionality; j++) {
+    uint *cellBox = context->topology->cellBox;
+    for (int j = 0; j < shape.dimensionality; j++) {
         uint index = idxsToModify[j];
-        uint r = index / context->dimensionality;
-        uint c = index % context->dimensionality;
-        uint b = (r / context->order) * context->order + (c / context->order);
-        if (b == box || !context->pencilMarks[index][pencilMark]) { continue; }
-        context->pencilMarks[index][pencilMark] = 0;
-        return 1;
+        if (cellBox[index] != box && hasPencilMark(pencilMarksForCell(context, shape, index), pencilMark)) {
+            removePencilMark(context, shape, index, pencilMark);
+            return 1;
+        }
     }
     return 0;
 }
 
-static int reducePencilMarksBoxCrossSectionForBox(MCSudokuSolveContext *context, uint box,
+MCShapeInline int reducePencilMarksBoxCrossSectionForBox(MCSudokuSolveContext *context, MCSudokuShape shape, uint box,
     MCPencilMarkSet *pencilMarkSet)
 {
-    int didChange = 0;
-    uint *boxIdxs = context->boxMap[box];
-    mapPencilMarkToCells(context, boxIdxs, pencilMarkSet);
-    
-    char *rows = calloc(sizeof(char), context->order), *cols = calloc(sizeof(char), context->order);
+    uint *cellRow = context->topology->cellRow, *cellColumn = context->topology->cellColumn;
+    mapPencilMarkToCells(context, shape, context->boxMap[box], pencilMarkSet);
     
-    for (uint i = 0; i < context->maxNumberForPencils; i++) {
+    for (uint i = 0; i < shape.dimensionality; i++) {
         // Does this pencilMark exist entirely in a row or col?
-        for (int j = 0; j < pencilMarkSet[i].countIndexes; j++) {
-            uint index = pencilMarkSet[i].indexes[j];
-            uint rowInBox = (index / context->dimensionality) % context->order;
-            uint colInBox = index % context->order;
-            rows[rowInBox] = 1;
-            cols[colInBox] = 1;
-        }
-        uint countOfPencilMarkPerRow = 0, countOfPencilMarkPerCol = 0;
-        for (int j = 0; j < context->order; j++) {
-            countOfPencilMarkPerRow += rows[j] ? 1 : 0;
-            countOfPencilMarkPerCol += cols[j] ? 1 : 0;
-        }
-        if (countOfPencilMarkPerRow == 1) {
-            uint rowToModify = pencilMarkSet[i].indexes[0] / context->dimensionality;
-            didChange = markupBoxCrossSection(context, box, i, context->rowMap[rowToModify]);
-            break;
-        }
-        else if (countOfPencilMarkPerCol == 1) {
-            uint colToModify = pencilMarkSet[i].indexes[0] % context->dimensionality;
-            didChange = markupBoxCrossSection(context, box, i, context->columnMap[colToModify]);
-            break;
-        }
-        else {
-            memset(rows, 0, sizeof(char) * context->order);
-            memset(cols, 0, sizeof(char) * context->order);
+        uint count = pencilMarkSet[i].countIndexes, *indexes = pencilMarkSet[i].indexes;
+        if (count == 0) { continue; }
+        uint row = cellRow[indexes[0]], column = cellColumn[indexes[0]];
+        int isInRow = 1, isInColumn = 1;
+        for (uint j = 1; j < count; j++) {
+            isInRow &= cellRow[indexes[j]] == row;
+            isInColumn &= cellColumn[indexes[j]] == column;
         }
+        if (isInRow)    { return markupBoxCrossSection(context, shape, box, i, context->rowMap[row]);       }
+        if (isInColumn) { return markupBoxCrossSection(context, shape, box, i, context->columnMap[column]); }
     }
-    free(rows);
-    free(cols);
-    
-    return didChange;
+    return 0;
+}
+
+// A box's cross sections depend on the rows and columns through it as well as the box itself. Versions only go up,
+// so their sum only stays the same while none of them change.
+MCShapeInline uint crossSectionVersion(MCSudokuSolveContext *context, MCSudokuShape shape, uint box)
+{
+    uint *unitVersions = propagationForContext(context)->unitVersions;
+    uint *rows = context->topology->boxRowMap[box], *columns = context->topology->boxColumnMap[box];
+    uint version = unitVersions[boxUnit(box)];
+    for (uint i = 0; i < shape.order; i++) {
+        version += unitVersions[rowUnit(rows[i])] + unitVersions[columnUnit(columns[i])];
+    }
+    return version;
 }
 
-static int reducePencilMarksBoxCrossSection(MCSudokuSolveContext *context)
+MCShapeInline int reducePencilMarksBoxCrossSection(MCSudokuSolveContext *context, MCSudokuShape shape)
 {
     int didChange = 0;
-    MCPencilMarkSet *pencilMarkMap = createPencilMarkMap(context);
-    for (int i = 0; i < context->dimensionality; i++) {
-        if (reducePencilMarksBoxCrossSectionForBox(context, i, pencilMarkMap)) {
+    MCSudokuPropagation *propagation = propagationForContext(context);
+    uint unitCount = shape.dimensionality * 3;
+    MCPencilMarkSet *pencilMarkMap = scratchForContext(context)->pencilMarkMap;
+    for (int i = 0; i < shape.dimensionality; i++) {
+        uint version = crossSectionVersion(context, shape, i);
+        if (isUnitChecked(propagation, MCSudokuTechniqueBoxCrossSection, unitCount, boxUnit(i), version)) { continue; }
+        if (reducePencilMarksBoxCrossSectionForBox(context, shape, i, pencilMarkMap)) {
             didChange = 1;
             break;
         }
+        setUnitChecked(propagation, MCSudokuTechniqueBoxCrossSection, unitCount, boxUnit(i), version);
     }
-    destroyPencilMarkMap(context, pencilMarkMap);
     return didChange;
 }
 
@@ -455,16 +1000,17 @@ static int isPuzzleValid(MCSudokuSolveContext *context)
 
 static void markup(MCSudokuSolveContext *context)
 {
+    MCSudokuShape shape = shapeForContext(context);
     for (uint i = 0; i < context->cellCount; i++) {
-        memset(context->pencilMarks[i], 1, sizeof(char) * context->maxNumberForPencils);
+        setAllPencilMarks(context, pencilMarksForCell(context, shape, i));
     }
     for (uint i = 0; i < context->cellCount; i++) {
         if (context->board[i] > 0) {
-            memset(context->pencilMarks[i], 0, sizeof(char) * context->maxNumberForPencils);
+            memset(pencilMarksForCell(context, shape, i), 0, sizeof(MCPencilMarkWord) * context->pencilMarkWordCount);
             for (uint j = 0; j < context->neighbourCount; j++) {
                 uint neighbourIndex = context->neighbourMap[i][j];
                 if (context->board[neighbourIndex] == 0) {
-                    context->pencilMarks[neighbourIndex][context->board[i] - 1] = 0;
+                    clearPencilMark(pencilMarksForCell(context, shape, neighbourIndex), context->board[i] - 1);
                 }
             }
         }
@@ -473,16 +1019,18 @@ static void markup(MCSudokuSolveContext *context)
 
 static uint cellWithFewestPencilMarks(MCSudokuSolveContext *context, uint *pencilMarkCount)
 {
+    MCSudokuShape shape = shapeForContext(context);
     uint leastMarks = UINT_MAX, index = UINT_MAX, count = 0;
-    uint *indexes = calloc(sizeof(uint), context->cellCount);
+    MCSudokuScratch *scratch = scratchForContext(context);
+    uint *indexes = scratch->cells;
+    uint8_t *counts = NULL;
+    if (context->pencilMarkWordCount == 1) {
+        counts = scratch->pencilMarkCounts;
+        scratch->kernels->count(context->pencilMarks, context->cellCount, counts);
+    }
     for (int i = 0; i < context->cellCount; i++) {
         if (context->board[i] > 0) { continue; }
-        uint markCount = 0;
-        for (int j = 0; j < context->maxNumberForPencils; j++) {
-            if (context->pencilMarks[i][j]) {
-                markCount++;
-            }
-        }
+        uint markCount = counts != NULL ? counts[i] : countPencilMarks(shape, pencilMarksForCell(context, shape, i));
         if (markCount != 0 && markCount <= leastMarks) {
             if (markCount < leastMarks) {
                 leastMarks = markCount;
@@ -492,8 +1040,7 @@ static uint cellWithFewestPencilMarks(MCSudokuSolveContext *context, uint *penci
             indexes[count++] = i;
         }
     }
-    index = indexes[arc4random() % count];
-    free(indexes);
+    index = indexes[randomBelow(&((MCSudokuSolveContextState *)context->opaque)->random, count)];
     *pencilMarkCount = leastMarks;
     return index;
 }
@@ -501,7 +1048,7 @@ static uint cellWithFewestPencilMarks(MCSudokuSolveContext *context, uint *penci
 static int valid(MCSudokuSolveContext *context)
 {
     int isValid = 1;
-    char *seenNumbers = malloc(sizeof(char) * context->dimensionality);
+    char *seenNumbers = scratchForContext(context)->seenNumbers;
     for (uint i = 0; i < context->dimensionality; i++) {
         uint *boxIdxs = context->boxMap[i];
         uint count = 0;
@@ -517,141 +1064,447 @@ static int valid(MCSudokuSolveContext *context)
             break;
         }
     }
-    free(seenNumbers);
     return isValid;
 }
 
 static int isSolved(MCSudokuSolveContext *context)
 {
-    for (uint i = 0; i < context->cellCount; i++) {
-        if (context->board[i] == 0) { return 0; }
-    }
-    return 1;
+    return propagationForContext(context)->emptyCellCount == 0;
 }
 
 static int pencilMarksValid(MCSudokuSolveContext *context)
 {
-    for (uint i = 0; i < context->cellCount; i++) {
-        if (context->board[i] > 0) { continue; }
-        uint count = 0;
-        for (uint j = 0; j < context->maxNumberForPencils; j++) {
-            if (context->pencilMarks[i][j]) {
-                count++;
-                break;
+    return !propagationForContext(context)->hasContradiction;
+}
+
+static MCSudokuSolveContextState *createSolveState(MCSudokuSolveContext *context, int backtracks)
+{
+    // The state can't count itself, so it starts the count.
+    MCSudokuSolveContextState *state = malloc(sizeof(MCSudokuSolveContextState));
+    state->allocationCount = 1;
+    initCancellationToken(&state->cancellation, NULL);
+    state->order = context->order;
+    state->guessDepth = 0;
+    state->guessCount = 0;
+    state->stepCount = 0;
+    state->counting = NULL;
+    seedRandom(&state->random, context->seed);
+    state->search = NULL;
+    state->trail = NULL;
+    state->guesses = NULL;
+    createPropagation(state, context);
+    createScratch(state, context);
+    if (backtracks) {
+        state->trail = allocateForSolve(state, sizeof(MCSudokuTrail));
+        state->trail->count = 0;
+        state->trail->capacity = context->cellCount * 4;
+        state->trail->entries = allocateForSolve(state, sizeof(MCSudokuTrailEntry) * state->trail->capacity);
+        state->guesses = allocateForSolve(state, sizeof(MCSudokuGuessStack));
+        state->guesses->count = 0;
+        state->guesses->capacity = 16;
+        state->guesses->guesses = allocateForSolve(state, sizeof(MCSudokuGuess) * state->guesses->capacity);
+        state->guesses->candidates = allocateForSolve(state, sizeof(MCPencilMarkWord) * context->pencilMarkWordCount *
+            state->guesses->capacity);
+    }
+    return state;
+}
+
+static void destroySolveState(MCSudokuSolveContextState *state)
+{
+    if (state->counting != NULL) { destroySolveState(state->counting); }
+    destroyPropagation(&state->propagation);
+    destroyScratch(&state->scratch);
+    if (state->trail != NULL) {
+        free(state->trail->entries);
+        free(state->trail);
+    }
+    if (state->guesses != NULL) {
+        free(state->guesses->guesses);
+        free(state->guesses->candidates);
+        free(state->guesses);
+    }
+    free(state);
+}
+
+static int shouldStopSolve(MCSudokuSolveContext *context)
+{
+    MCSudokuSolveContextState *state = context->opaque;
+    MCSudokuAllowance *allowance = state->cancellation.allowance;
+    if (allowance != NULL && (++state->stepCount & (MCDeadlineCheckInterval - 1)) == 0) { checkDeadline(allowance); }
+    return isCancelled(&state->cancellation);
+}
+
+static void recordSolution(MCSudokuSolveContext *context)
+{
+    MCSudokuSolveContextState *state = context->opaque;
+    MCSudokuSearch *search = state->search;
+    if (search == NULL) {
+        if (context->solutionCount == 0) {
+            memcpy(context->solution, context->board, sizeof(uint) * context->cellCount);
+        }
+        context->solutionCount++;
+        return;
+    }
+    pthread_mutex_lock(&search->lock);
+    if (search->callback != NULL) {
+        // Branches still running once the enumeration has been stopped can find more, which aren't passed on.
+        if (search->solutionCount < search->limit && !isCancelled(&search->cancellation)) {
+            if (search->solutionCount++ == 0) {
+                memcpy(search->context->solution, context->board, sizeof(uint) * context->cellCount);
+            }
+            if (!search->callback(context->board, search->callbackInfo) || search->solutionCount == search->limit) {
+                cancelToken(&search->cancellation, MCSolveStatusCancelled);
             }
         }
-        if (count == 0) { return 0; }
+        pthread_mutex_unlock(&search->lock);
+        return;
     }
-    return 1;
+    if (search->solutionCount == 0) {
+        memcpy(search->context->solution, context->board, sizeof(uint) * context->cellCount);
+        // Every guess on the way to the solution makes the puzzle harder.
+        search->difficultyScore = context->difficultyScore + 100 * state->guessDepth;
+    }
+    if (++search->solutionCount > 1) { cancelToken(&search->cancellation, MCSolveStatusMultipleSolutions); }
+    pthread_mutex_unlock(&search->lock);
+}
+
+#pragma mark Branch States
+
+static pthread_key_t branchStateKey;
+static pthread_once_t branchStateKeyOnce = PTHREAD_ONCE_INIT;
+
+static void destroyCachedBranchState(void *state)
+{
+    destroySolveState(state);
+}
+
+static void createBranchStateKey(void)
+{
+    pthread_key_create(&branchStateKey, destroyCachedBranchState);
 }
 
-static void prepareForTrial(MCSudokuSolveContext *dest, MCSudokuSolveContext *src)
+// Each thread keeps the state of the last branch it searched, so a worker going from branch to branch reuses the
+// trail, guess stack and scratch space it has already grown instead of allocating new ones. A branch searched while
+// another is running on the same thread just gets a state of its own.
+static MCSudokuSolveContextState *takeBranchState(MCSudokuSolveContext *context, MCSudokuSearch *search)
+{
+    pthread_once(&branchStateKeyOnce, createBranchStateKey);
+    MCSudokuSolveContextState *state = pthread_getspecific(branchStateKey);
+    if (state != NULL) {
+        pthread_setspecific(branchStateKey, NULL);
+        state->allocationCount = 0;
+    }
+    if (state != NULL && state->order != context->order) {
+        destroySolveState(state);
+        state = NULL;
+    }
+    if (state == NULL) { state = createSolveState(context, 1); }
+    initCancellationToken(&state->cancellation, &search->cancellation);
+    state->search = search;
+    state->trail->count = 0;
+    state->guesses->count = 0;
+    state->guessCount = 0;
+    return state;
+}
+
+static void returnBranchState(MCSudokuSolveContextState *state)
+{
+    if (pthread_getspecific(branchStateKey) == NULL) { pthread_setspecific(branchStateKey, state); }
+    else { destroySolveState(state); }
+}
+
+#pragma mark Searching Branches
+
+static void solveContextIteratively(MCSudokuSolveContext *context);
+static void enumerateSolutionsIteratively(MCSudokuSolveContext *context);
+
+static void searchBranch(void *argument)
 {
-    *dest = *src;
-    size_t boardSize = sizeof(uint) * src->cellCount,
-    pencilMarkSize = sizeof(char) * src->maxNumberForPencils;
-    dest->board = malloc(boardSize);
-    memcpy(dest->board, src->board, boardSize);
-    dest->pencilMarks = malloc(sizeof(char *) * src->cellCount);
-    dest->pencilMarks[0] = malloc(pencilMarkSize * src->cellCount);
-    dest->solution = malloc(boardSize);
-    memcpy(dest->pencilMarks[0], src->pencilMarks[0], pencilMarkSize * src->cellCount);
-    for (uint j = 1; j < src->cellCount; j++) {
-        dest->pencilMarks[j] = &dest->pencilMarks[0][j * pencilMarkSize];
+    MCSudokuBranch *branch = argument;
+    MCSudokuSearch *search = branch->search;
+    if (!isCancelled(&search->cancellation)) {
+        MCSudokuSolveContext trial = *search->context;
+        MCSudokuSolveContextState *state = takeBranchState(&trial, search);
+        state->guessDepth = branch->guessDepth;
+        state->random = branch->random;
+        trial.opaque = state;
+        trial.board = branch->board;
+        trial.pencilMarks = branch->pencilMarks;
+        trial.difficultyScore = branch->difficultyScore;
+        trial.solutionCount = 0;
+        spendGuess(state->cancellation.allowance);
+        beginPropagation(&trial);
+        placeNumber(&trial, shapeForContext(&trial), branch->guessSquare, branch->number);
+        if (search->callback != NULL) { enumerateSolutionsIteratively(&trial); }
+        else { solveContextIteratively(&trial); }
+        atomic_fetch_add_explicit(&search->guessCount, state->guessCount + 1, memory_order_relaxed);
+        atomic_fetch_add_explicit(&search->allocationCount, state->allocationCount, memory_order_relaxed);
+        returnBranchState(state);
     }
-    MCSudokuSolveContextStopSolve *stopSolve = malloc(sizeof(MCSudokuSolveContextStopSolve));
-    stopSolve->lock = dispatch_semaphore_create(1);
-    stopSolve->stopSolve = 0;
-    dest->opaque = stopSolve;
+    free(branch);
 }
 
-static void destroyTrial(MCSudokuSolveContext *trial)
+// Each branch's random state is split from the one at the guess by the number it tries, so it makes the same choices
+// wherever it runs.
+static void spawnBranch(MCSudokuSearch *search, MCSudokuSolveContext *context, const MCRandomState *random,
+    uint guessDepth, uint guessSquare, uint number)
 {
-    free(trial->board);
-    free(trial->solution);
-    free(trial->pencilMarks[0]);
-    free(trial->pencilMarks);
-    dispatch_release(((MCSudokuSolveContextStopSolve *)trial->opaque)->lock);
-    free(trial->opaque);
+    size_t boardSize = sizeof(uint) * context->cellCount,
+    pencilMarkSize = sizeof(MCPencilMarkWord) * context->pencilMarkWordCount * context->cellCount;
+    MCSudokuBranch *branch = allocateForSolve(context->opaque, sizeof(MCSudokuBranch) + pencilMarkSize + boardSize);
+    branch->search = search;
+    branch->pencilMarks = (MCPencilMarkWord *)(branch + 1);
+    memcpy(branch->pencilMarks, context->pencilMarks, pencilMarkSize);
+    branch->board = (uint *)((char *)branch->pencilMarks + pencilMarkSize);
+    memcpy(branch->board, context->board, boardSize);
+    branch->difficultyScore = context->difficultyScore;
+    branch->guessDepth = guessDepth;
+    branch->guessSquare = guessSquare;
+    branch->number = number;
+    branch->random = splitRandom(random, number);
+    spawnTask(&search->branches, searchBranch, branch);
 }
 
-static void stopGuessing(MCSudokuSolveContext trials[], uint trialCount)
+// Guesses close to the root are always handed out to other workers. Deeper guesses are only split while some
+// threads have nothing to do, otherwise the worker searches them depth first on its own board.
+static int shouldSplitSearch(MCSudokuSolveContextState *state)
 {
-    for (int i = 0; i < trialCount; i++) {
-        MCSudokuSolveContextStopSolve *stopSolve = trials[i].opaque;
-        dispatch_semaphore_wait(stopSolve->lock, DISPATCH_TIME_FOREVER);
-        stopSolve->stopSolve = 1;
-        dispatch_semaphore_signal(stopSolve->lock);
+    if (state->search == NULL) { return 0; }
+    if (state->guessDepth < MCSearchSplitDepth) { return 1; }
+    return state->guessDepth < MCSearchIdleSplitDepth && idleWorkerCount() > 0;
+}
+
+// Makes a guess on the context's own board. Unless the search is split, each candidate of the guess square is tried
+// in turn by nextGuess.
+static void pushGuess(MCSudokuSolveContext *context, MCSudokuSolveContextState *state)
+{
+    MCSudokuShape shape = shapeForContext(context);
+    MCSudokuGuessStack *stack = state->guesses;
+    if (stack->count == stack->capacity) {
+        stack->capacity *= 2;
+        stack->guesses = reallocateForSolve(state, stack->guesses, sizeof(MCSudokuGuess) * stack->capacity);
+        stack->candidates = reallocateForSolve(state, stack->candidates,
+            sizeof(MCPencilMarkWord) * context->pencilMarkWordCount * stack->capacity);
+    }
+    MCSudokuGuess *guess = &stack->guesses[stack->count];
+    MCPencilMarkWord *candidates = stack->candidates + stack->count * context->pencilMarkWordCount;
+    uint trialCount = 0;
+    guess->guessSquare = cellWithFewestPencilMarks(context, &trialCount);
+    guess->random = state->random;
+    memcpy(candidates, pencilMarksForCell(context, shape, guess->guessSquare),
+        sizeof(MCPencilMarkWord) * context->pencilMarkWordCount);
+    
+    if (trialCount > 1 && shouldSplitSearch(state)) {
+        uint first = UINT_MAX;
+        for (uint i = 0; i < context->maxNumberForPencils; i++) {
+            if (!hasPencilMark(candidates, i)) { continue; }
+            if (first == UINT_MAX) { first = i; continue; }
+            spawnBranch(state->search, context, &guess->random, state->guessDepth + 1, guess->guessSquare, i + 1);
+            clearPencilMark(candidates, i);
+        }
+    }
+    
+    guess->mark = state->trail->count;
+    guess->difficultyScore = context->difficultyScore;
+    guess->nextPencilMark = 0;
+    stack->count++;
+    state->guessDepth++;
+}
+
+// Rolls the board back to the innermost guess that has a candidate left and places that candidate, dropping guesses
+// that have run out. Returns 0 once there are no guesses left or the solve has been stopped.
+static int nextGuess(MCSudokuSolveContext *context, MCSudokuSolveContextState *state)
+{
+    MCSudokuShape shape = shapeForContext(context);
+    MCSudokuGuessStack *stack = state->guesses;
+    while (stack->count > 0) {
+        MCSudokuGuess *guess = &stack->guesses[stack->count - 1];
+        MCPencilMarkWord *candidates = stack->candidates + (stack->count - 1) * context->pencilMarkWordCount;
+        uint pencilMark = guess->nextPencilMark;
+        if (pencilMark > 0) {
+            undoTrail(context, guess->mark);
+            context->difficultyScore = guess->difficultyScore;
+            if (shouldStopSolve(context)) { pencilMark = context->maxNumberForPencils; }
+        }
+        while (pencilMark < context->maxNumberForPencils && !hasPencilMark(candidates, pencilMark)) { pencilMark++; }
+        if (pencilMark < context->maxNumberForPencils) {
+            guess->nextPencilMark = pencilMark + 1;
+            placeNumber(context, shape, guess->guessSquare, pencilMark + 1);
+            state->random = splitRandom(&guess->random, pencilMark + 1);
+            state->guessCount++;
+            spendGuess(state->cancellation.allowance);
+            return 1;
+        }
+        state->random = guess->random;
+        state->guessDepth--;
+        stack->count--;
     }
+    return 0;
 }
 
-static void solveContextRecursive(MCSudokuSolveContext *context);
+static void initSearch(MCSudokuSearch *search, MCSudokuSolveContext *context, MCSudokuSolveContextState *state)
+{
+    search->context = context;
+    initCancellationToken(&search->cancellation, &state->cancellation);
+    search->solutionCount = 0;
+    search->difficultyScore = 0;
+    atomic_init(&search->guessCount, 0);
+    atomic_init(&search->allocationCount, 0);
+    search->callback = NULL;
+    search->callbackInfo = NULL;
+    search->limit = 0;
+    pthread_mutex_init(&search->lock, NULL);
+    initTaskGroup(&search->branches);
+}
+
+// The first guess of a solve hands every candidate to a branch of its own and waits for them all.
 static void makeGuess(MCSudokuSolveContext *context)
 {
+    MCSudokuShape shape = shapeForContext(context);
+    MCSudokuSolveContextState *state = context->opaque;
     uint trialCount = 0;
     uint guessSquare = cellWithFewestPencilMarks(context, &trialCount);
-
-    MCSudokuSolveContext *trials = malloc(sizeof(MCSudokuSolveContext) * trialCount);
-    for (uint i = 0, j = 0; i < context->maxNumberForPencils; i++) {
-        if (!context->pencilMarks[guessSquare][i]) { continue; }
-        prepareForTrial(&trials[j], context);
-        trials[j].board[guessSquare] = i + 1;
-        for (uint k = 0; k < context->neighbourCount; k++) {
-            trials[j].pencilMarks[context->neighbourMap[guessSquare][k]][i] = 0;
-        }
-        j++;
-    }
-    dispatch_semaphore_t solutionsLock = dispatch_semaphore_create(1);
-    __block int solutions = 0;
-    dispatch_apply(trialCount, dispatch_get_global_queue(QOS_CLASS_DEFAULT, 0), ^(size_t i) {
-        MCSudokuSolveContext *trial = &trials[i];
-        solveContextRecursive(trial);
-        if (trial->solutionCount == 0) { return; }
-        dispatch_semaphore_wait(solutionsLock, DISPATCH_TIME_FOREVER);
-        solutions += trial->solutionCount;
-        memcpy(context->solution, trial->solution, sizeof(uint) * context->cellCount);
-        if (solutions > 1) { stopGuessing(trials, trialCount); }
-        else { context->difficultyScore = trial->difficultyScore + 100; }
-        dispatch_semaphore_signal(solutionsLock);
-        
-    });
-    context->solutionCount = solutions;
-    dispatch_release(solutionsLock);
-    for (uint i = 0; i < trialCount; i++) { destroyTrial(&trials[i]); }
-    free(trials);
+    
+    MCSudokuSearch search;
+    initSearch(&search, context, state);
+    for (uint i = 0; i < context->maxNumberForPencils; i++) {
+        if (!hasPencilMark(pencilMarksForCell(context, shape, guessSquare), i)) { continue; }
+        spawnBranch(&search, context, &state->random, 1, guessSquare, i + 1);
+    }
+    waitForTaskGroup(&search.branches);
+    
+    context->solutionCount = search.solutionCount;
+    context->guessCount = atomic_load(&search.guessCount);
+    state->allocationCount += atomic_load(&search.allocationCount);
+    if (search.solutionCount == 1) { context->difficultyScore = search.difficultyScore; }
+    pthread_mutex_destroy(&search.lock);
 }
 
 #pragma mark Main Solve Functions
 
-static int shouldStopSolve(MCSudokuSolveContext *context)
+// Makes deductions until the board is solved, can't be solved or needs a guess. Returns whether a guess is needed.
+MCShapeInline int reduceUntilGuess(MCSudokuSolveContext *context, MCSudokuShape shape)
 {
-    MCSudokuSolveContextStopSolve *stopSolve = context->opaque;
-    dispatch_semaphore_wait(stopSolve->lock, DISPATCH_TIME_FOREVER);
-    int shouldStop = stopSolve->stopSolve;
-    dispatch_semaphore_signal(stopSolve->lock);
-    return shouldStop;
+    while (!shouldStopSolve(context)) {
+        if (isSolved(context) && valid(context)) {
+            recordSolution(context);
+            return 0;
+        }
+        if (!pencilMarksValid(context)) { return 0; }
+        
+        uint singlesScore = reduceSingles(context, shape);
+        if      (singlesScore > 0)                                  { context->difficultyScore += singlesScore; }
+        else if (reducePencilMarks(context, shape))                 { context->difficultyScore += 25;   }
+        else if (reduceHiddenPencilMarks(context, shape))           { context->difficultyScore += 50;   }
+        else if (reducePencilMarksBoxCrossSection(context, shape))  { context->difficultyScore += 50;   }
+        else                                                        { return 1;                         }
+    }
+    return 0;
 }
 
-static void solveContextRecursive(MCSudokuSolveContext *context)
+// Solves that only need to know how many solutions there are place singles between guesses and nothing else, since
+// how hard the puzzle is doesn't matter, and stop as soon as limit solutions have turned up. Everything happens in
+// order on the calling thread.
+MCShapeInline void countSolutionsIteratively(MCSudokuSolveContext *context, MCSudokuShape shape, uint limit)
 {
-    if (shouldStopSolve(context)) { return; }
-    if (isSolved(context) && valid(context)) {
-        if (context->solutionCount == 0) {
-            memcpy(context->solution, context->board, sizeof(uint) * context->cellCount);
+    MCSudokuSolveContextState *state = context->opaque;
+    do {
+        reduceSingles(context, shape);
+        if (shouldStopSolve(context)) { return; }
+        if (!pencilMarksValid(context)) { continue; }
+        if (!isSolved(context)) {
+            pushGuess(context, state);
         }
-        context->solutionCount++;
-        return;
+        else if (valid(context)) {
+            recordSolution(context);
+            if (context->solutionCount >= limit) { return; }
+        }
+    } while (nextGuess(context, state));
+}
+
+#pragma mark Solvers
+
+// The solve loops, built for one shape.
+typedef struct _MCSudokuSolver {
+    int (*reduceUntilGuess)(MCSudokuSolveContext *context);
+    void (*countSolutions)(MCSudokuSolveContext *context, uint limit);
+} MCSudokuSolver;
+
+#define MCDefineSolver(name, shape)                                                                                 \
+    static int reduceUntilGuess##name(MCSudokuSolveContext *context)                                                \
+    {                                                                                                               \
+        return reduceUntilGuess(context, shape);                                                                    \
+    }                                                                                                               \
+    static void countSolutions##name(MCSudokuSolveContext *context, uint limit)                                     \
+    {                                                                                                               \
+        countSolutionsIteratively(context, shape, limit);                                                           \
+    }                                                                                                               \
+    static const MCSudokuSolver solver##name = { reduceUntilGuess##name, countSolutions##name };
+
+// 9x9 puzzles are nearly all of what gets solved, so order 3 gets solve loops built for its shape, as do 4x4 and
+// 16x16, the next most likely. Other orders share the ones that read the sizes from the context.
+MCDefineSolver(Order2, shapeForOrder(2))
+MCDefineSolver(Order3, shapeForOrder(3))
+MCDefineSolver(Order4, shapeForOrder(4))
+MCDefineSolver(AnyOrder, shapeForContext(context))
+
+static const MCSudokuSolver *solverForOrder(uint order)
+{
+    switch (order) {
+        case 2:     return &solverOrder2;
+        case 3:     return &solverOrder3;
+        case 4:     return &solverOrder4;
+        default:    return &solverAnyOrder;
     }
-    if (!pencilMarksValid(context)) { return; }
-    
-    if      (reduceSingle(context))                     { context->difficultyScore += 1;    }
-    else if (reduceHiddenSingle(context))               { context->difficultyScore += 10;   }
-    else if (reducePencilMarks(context))                { context->difficultyScore += 25;   }
-    else if (reduceHiddenPencilMarks(context))          { context->difficultyScore += 50;   }
-    else if (reducePencilMarksBoxCrossSection(context)) { context->difficultyScore += 50;   }
-    else                                                { makeGuess(context); return;       }
+}
+
+// Guesses made on a branch are kept on the context's guess stack rather than the call stack, so the stack a solve
+// needs doesn't grow with the order of the puzzle or how deep the guesses go.
+static void solveContextIteratively(MCSudokuSolveContext *context)
+{
+    MCSudokuSolveContextState *state = context->opaque;
+    const MCSudokuSolver *solver = solverForOrder(context->order);
+    do {
+        if (solver->reduceUntilGuess(context)) {
+            if (state->guesses == NULL) {
+                makeGuess(context);
+                return;
+            }
+            pushGuess(context, state);
+        }
+    } while (state->guesses != NULL && nextGuess(context, state));
+}
+
+// Enumerating branches count without a limit, the search cancels them once it has passed on enough solutions.
+static void enumerateSolutionsIteratively(MCSudokuSolveContext *context)
+{
+    solverForOrder(context->order)->countSolutions(context, UINT_MAX);
+}
+
+// Counts on a backtracking state kept for the purpose, created the first time the context needs it. It works on the
+// context's own board. When enumerating, solutions go to search and guesses near the root are split off into branches
+// for other workers, which the caller waits for. Returns the number of solutions counted, which is 0 when enumerating.
+static uint countSolutionsOfProblem(MCSudokuSolveContext *context, MCSudokuSearch *search, uint limit)
+{
+    MCSudokuSolveContextState *state = context->opaque;
+    if (state->counting == NULL) { state->counting = createSolveState(context, 1); }
+    else { state->counting->allocationCount = 0; }
+    MCSudokuSolveContextState *counting = state->counting;
+    initCancellationToken(&counting->cancellation, search != NULL ? &search->cancellation : &state->cancellation);
+    counting->search = search;
+    counting->trail->count = 0;
+    counting->guesses->count = 0;
+    counting->guessDepth = 0;
+    counting->guessCount = 0;
+    seedRandom(&counting->random, context->seed);
     
-    solveContextRecursive(context);
+    MCSudokuSolveContext trial = *context;
+    trial.opaque = counting;
+    memcpy(trial.board, trial.problem, sizeof(uint) * trial.cellCount);
+    markup(&trial);
+    beginPropagation(&trial);
+    if (isPuzzleValid(&trial)) { solverForOrder(trial.order)->countSolutions(&trial, limit); }
+    return trial.solutionCount;
 }
 
 #pragma mark Generating Puzzles
@@ -666,27 +1519,27 @@ static MCPuzzleDifficulty convertDifficultyScore(uint difficultyScore, uint orde
     return MCPuzzleDifficultyInsane;
 }
 
-static uint targetDifficultyScore(MCPuzzleDifficulty difficulty, uint order)
+static uint targetDifficultyScore(MCPuzzleDifficulty difficulty, uint order, MCRandomState *random)
 {
     switch (difficulty) {
         case MCPuzzleDifficultyEasy:
         {
-            uint score = arc4random() % (order * (MCPuzzleDifficultyNormal - MCPuzzleDifficultyEasy));
+            uint score = randomBelow(random, order * (MCPuzzleDifficultyNormal - MCPuzzleDifficultyEasy));
             return MCPuzzleDifficultyEasy * order + score;
         }
         case MCPuzzleDifficultyNormal:
         {
-            uint score = arc4random() % (order * (MCPuzzleDifficultyHard - MCPuzzleDifficultyNormal));
+            uint score = randomBelow(random, order * (MCPuzzleDifficultyHard - MCPuzzleDifficultyNormal));
             return MCPuzzleDifficultyNormal * order + score;
         }
         case MCPuzzleDifficultyHard:
         {
-            uint score = arc4random() % (order * (MCPuzzleDifficultyInsane - MCPuzzleDifficultyHard));
+            uint score = randomBelow(random, order * (MCPuzzleDifficultyInsane - MCPuzzleDifficultyHard));
             return MCPuzzleDifficultyHard * order + score;
         }
         case MCPuzzleDifficultyInsane:
         {
-            uint score = arc4random() % (order * MCPuzzleDifficultyInsane);
+            uint score = randomBelow(random, order * MCPuzzleDifficultyInsane);
             return MCPuzzleDifficultyInsane * order + score;
         }
         case MCPuzzleDifficultyZero:
@@ -695,187 +1548,272 @@ static uint targetDifficultyScore(MCPuzzleDifficulty difficulty, uint order)
     }
 }
 
-static void removeNumbersFromBoard(MCSudokuSolveContext *context, MCPuzzleDifficulty expectedDifficulty)
+static uint difficultyDistance(uint difficultyScore, uint targetDifficulty)
+{
+    return difficultyScore < targetDifficulty ? targetDifficulty - difficultyScore : difficultyScore - targetDifficulty;
+}
+
+static void removeNumbersAttempt(void *argument)
 {
-    dispatch_semaphore_t lock = dispatch_semaphore_create(1);
+    MCRemovalAttempt *attempt = argument;
+    MCNumberRemoval *removal = attempt->removal;
+    MCSudokuSolveContext *context = removal->context;
+    size_t puzzleSize = sizeof(uint) * context->cellCount;
+    MCRandomState random;
+    seedRandom(&random, attempt->seed);
     
-    uint targetDifficulty = targetDifficultyScore(expectedDifficulty, context->order);
+    MCSudokuSolveContext *testContext = malloc(sizeof(MCSudokuSolveContext));
+    // Every attempt grades with the context's own seed, so the score kept is the one a solve of the puzzle gives.
+    memcpy(testContext, context, sizeof(MCSudokuSolveContext));
     
-    uint *allIndexes = calloc(sizeof(uint), context->cellCount);
-    for (uint i = 0; i < context->cellCount; i++) {
-        allIndexes[i] = i;
-    }
+    // Solves of the test context are part of generating the puzzle, so they are stopped along with it and spend its
+    // budget rather than one of their own.
+    const MCCancellationToken *cancellation = &((MCSudokuSolveContextState *)context->opaque)->cancellation;
+    testContext->opaque = createSolveState(testContext, 0);
+    initCancellationToken(&((MCSudokuSolveContextState *)testContext->opaque)->cancellation, cancellation);
     
-    size_t puzzleSize = sizeof(uint) * context->cellCount;
+    testContext->problem = malloc(puzzleSize);
+    testContext->solution = malloc(puzzleSize);
+    testContext->board = malloc(puzzleSize);
+    testContext->pencilMarks = malloc(sizeof(MCPencilMarkWord) * context->cellCount * context->pencilMarkWordCount);
     
-    uint *targetProblem = malloc(puzzleSize);
-    __block uint hardestDifficulty = 0;
+    memcpy(testContext->problem, context->problem, puzzleSize);
     
-    void (^generationLoop)(size_t) = ^(size_t iter) {
-        MCSudokuSolveContext *testContext = malloc(sizeof(MCSudokuSolveContext));
-        memcpy(testContext, context, sizeof(MCSudokuSolveContext));
-        
-        MCSudokuSolveContextStopSolve *stopSolve = malloc(sizeof(MCSudokuSolveContextStopSolve));
-        stopSolve->stopSolve = 0;
-        stopSolve->lock = dispatch_semaphore_create(1);
-        testContext->opaque = stopSolve;
-        
-        testContext->problem = malloc(puzzleSize);
-        testContext->solution = malloc(puzzleSize);
-        testContext->board = malloc(puzzleSize);
-        testContext->pencilMarks = malloc(sizeof(char*) * context->cellCount);
-        testContext->pencilMarks[0] = malloc(sizeof(char) * context->cellCount * context->maxNumberForPencils);
-        for (uint i = 1; i < context->cellCount; i++) {
-            testContext->pencilMarks[i] = &testContext->pencilMarks[0][i * context->maxNumberForPencils];
+    int startIndex = 0, endIndex = context->cellCount;
+    uint *indexes = malloc(puzzleSize);
+    memcpy(indexes, removal->allIndexes, puzzleSize);
+    
+    while (endIndex - startIndex > 0 && !isCancelled(cancellation)) {
+        uint indexToIndex = startIndex + randomBelow(&random, endIndex - startIndex);
+        uint index = indexes[indexToIndex];
+        if ((indexToIndex - startIndex) < (endIndex - indexToIndex - 1)) {
+            memmove(indexes + startIndex + 1, indexes + startIndex, sizeof(uint) * (indexToIndex - startIndex));
+            startIndex++;
         }
+        else {
+            memmove(indexes + indexToIndex, indexes + indexToIndex + 1,
+                sizeof(uint) * (endIndex - indexToIndex - 1));
+            endIndex--;
+        }
+        testContext->problem[index] = 0;
         
-        memcpy(testContext->problem, context->problem, puzzleSize);
-        
-        int startIndex = 0, endIndex = context->cellCount;
-        uint *indexes = malloc(puzzleSize);
-        memcpy(indexes, allIndexes, puzzleSize);
-        
-        while (endIndex - startIndex > 0) {
-            uint indexToIndex = startIndex + (arc4random() % (endIndex - startIndex));
-            uint index = indexes[indexToIndex];
-            if ((indexToIndex - startIndex) < (endIndex - indexToIndex - 1)) {
-                memmove(indexes + startIndex + 1, indexes + startIndex, sizeof(uint) * (indexToIndex - startIndex));
-                startIndex++;
-            }
-            else {
-                memmove(indexes + indexToIndex, indexes + indexToIndex + 1,
-                    sizeof(uint) * (endIndex - indexToIndex - 1));
-                endIndex--;
-            }
-            testContext->problem[index] = 0;
+        // Most removals leave more than one solution, which counting finds far faster than grading.
+        if (countSolutions(testContext, 2) == 1 && solveContext(testContext) &&
+            convertDifficultyScore(testContext->difficultyScore, testContext->order) <= removal->expectedDifficulty) {
             
-            if (solveContext(testContext) &&
-                convertDifficultyScore(testContext->difficultyScore, testContext->order) <= expectedDifficulty) {
-                
-                dispatch_semaphore_wait(lock, DISPATCH_TIME_FOREVER);
-                uint targetDeltaMagnitude = targetDifficulty < testContext->difficultyScore ?
-                    testContext->difficultyScore - targetDifficulty :
-                    targetDifficulty - testContext->difficultyScore;
-                uint hardestDeltaMagnitude = targetDifficulty < hardestDifficulty ?
-                    hardestDifficulty - targetDifficulty :
-                    targetDifficulty - hardestDifficulty;
-                if (targetDeltaMagnitude < hardestDeltaMagnitude) {
-                    hardestDifficulty = testContext->difficultyScore;
-                    memcpy(targetProblem, testContext->problem, puzzleSize);
-                }
-                dispatch_semaphore_signal(lock);
-            }
-            else {
-                testContext->problem[index] = context->solution[index];
+            uint targetDifficulty = removal->targetDifficulty;
+            if (difficultyDistance(testContext->difficultyScore, targetDifficulty) <
+                difficultyDistance(attempt->hardestDifficulty, targetDifficulty)) {
+                attempt->hardestDifficulty = testContext->difficultyScore;
+                memcpy(attempt->targetProblem, testContext->problem, puzzleSize);
             }
         }
-        dispatch_release(stopSolve->lock);
-        free(stopSolve);
-        free(testContext->problem);
-        free(testContext->solution);
-        free(testContext->board);
-        free(testContext->pencilMarks[0]);
-        free(testContext->pencilMarks);
-        free(testContext);
-        free(indexes);
-    };
+        else {
+            testContext->problem[index] = context->solution[index];
+        }
+    }
+    destroySolveState(testContext->opaque);
+    free(testContext->problem);
+    free(testContext->solution);
+    free(testContext->board);
+    free(testContext->pencilMarks);
+    free(testContext);
+    free(indexes);
+}
+
+static void removeNumbersFromBoard(MCSudokuSolveContext *context, MCPuzzleDifficulty expectedDifficulty,
+    MCRandomState *random)
+{
+    size_t puzzleSize = sizeof(uint) * context->cellCount;
+    MCNumberRemoval removal;
+    removal.context = context;
+    removal.expectedDifficulty = expectedDifficulty;
+    removal.targetDifficulty = targetDifficultyScore(expectedDifficulty, context->order, random);
     
-    dispatch_apply(20, dispatch_get_global_queue(QOS_CLASS_DEFAULT, 0), generationLoop);
-    memcpy(context->problem, targetProblem, sizeof(uint) * context->cellCount);
-    context->difficultyScore = hardestDifficulty;
+    removal.allIndexes = calloc(sizeof(uint), context->cellCount);
+    for (uint i = 0; i < context->cellCount; i++) {
+        removal.allIndexes[i] = i;
+    }
+    
+    MCRemovalAttempt attempts[MCRemovalAttemptCount];
+    MCTaskGroup group;
+    initTaskGroup(&group);
+    for (uint i = 0; i < MCRemovalAttemptCount; i++) {
+        attempts[i].removal = &removal;
+        attempts[i].seed = nextRandom(random);
+        attempts[i].hardestDifficulty = 0;
+        attempts[i].targetProblem = malloc(puzzleSize);
+        memcpy(attempts[i].targetProblem, context->problem, puzzleSize);
+        spawnTask(&group, removeNumbersAttempt, &attempts[i]);
+    }
+    waitForTaskGroup(&group);
+    
+    // Ties go to the earliest attempt, so the result doesn't depend on which attempt finished first.
+    MCRemovalAttempt *best = &attempts[0];
+    for (uint i = 1; i < MCRemovalAttemptCount; i++) {
+        if (difficultyDistance(attempts[i].hardestDifficulty, removal.targetDifficulty) <
+            difficultyDistance(best->hardestDifficulty, removal.targetDifficulty)) {
+            best = &attempts[i];
+        }
+    }
+    memcpy(context->problem, best->targetProblem, puzzleSize);
+    context->difficultyScore = best->hardestDifficulty;
     context->difficulty = convertDifficultyScore(context->difficultyScore, context->order);
-    dispatch_release(lock);
-    free(targetProblem);
-    free(allIndexes);
+    for (uint i = 0; i < MCRemovalAttemptCount; i++) { free(attempts[i].targetProblem); }
+    free(removal.allIndexes);
 }
 
-#pragma mark Private Functions - Context set up
+#pragma mark Starting and Finishing Solves
 
-static void setUpRegions(MCSudokuSolveContext *context)
+// Clears the cancellation left by the last solve and starts spending the context's budget. A context whose token has
+// a parent is solved as part of its parent's work and spends the parent's budget instead.
+static void beginSolve(MCSudokuSolveContext *context)
 {
-    for (int i = 0; i < context->cellCount; i++) {
-        int row = i / context->dimensionality;
-        int column = i % context->dimensionality;
-        int box = (row / context->order) * context->order + (column / context->order);
-        
-        context->rowMap[row][column] = i;
-        context->columnMap[column][row] = i;
-        context->boxMap[box][(row % context->order) * context->order + (column % context->order)] = i;
+    MCSudokuSolveContextState *state = context->opaque;
+    atomic_store_explicit(&state->cancellation.isCancelled, 0, memory_order_relaxed);
+    if (state->cancellation.parent == NULL) {
+        startAllowance(&state->allowance, &state->cancellation, context->budget);
     }
 }
 
-static void setUpNeighbours(MCSudokuSolveContext *context)
+// How a solve that found solutionCount solutions ended.
+static MCSolveStatus solveStatus(MCSudokuSolveContext *context)
 {
-    char *indexSet = malloc(sizeof(char) * context->cellCount);
-    for (int i = 0; i < context->cellCount; i++) {
-        memset(indexSet, 0, sizeof(char) * context->cellCount);
-        uint row = i / context->dimensionality;
-        uint column = i % context->dimensionality;
-        uint box = (row / context->order) * context->order + (column / context->order);
-        
-        for (int j = 0; j < context->dimensionality; j++) {
-            uint rowIndex = context->rowMap[row][j],
-            colIndex = context->columnMap[column][j],
-            boxIndex = context->boxMap[box][j];
-            indexSet[rowIndex] = rowIndex != i;
-            indexSet[colIndex] = colIndex != i;
-            indexSet[boxIndex] = boxIndex != i;
-        }
-        
-        int neighbourIndex = 0;
-        for (uint j = 0; j < context->cellCount; j++) {
-            if (indexSet[j]) {
-                context->neighbourMap[i][neighbourIndex++] = j;
-            }
-        }
-    }
-    free(indexSet);
+    int reason = isCancelled(&((MCSudokuSolveContextState *)context->opaque)->cancellation);
+    if      (reason != 0)                   { return reason;                    }
+    else if (context->solutionCount == 0)   { return MCSolveStatusNoSolution;   }
+    else if (context->solutionCount == 1)   { return MCSolveStatusSolved;       }
+    
+    return MCSolveStatusMultipleSolutions;
+}
+
+// solveContext, once the solve has begun.
+static int solveProblem(MCSudokuSolveContext *context)
+{
+    MCSudokuSolveContextState *state = context->opaque;
+    seedRandom(&state->random, context->seed);
+    state->allocationCount = 0;
+    context->solutionCount = 0;
+    context->difficultyScore = 0;
+    context->guessCount = 0;
+    memcpy(context->board, context->problem, sizeof(uint) * context->cellCount);
+    markup(context);
+    beginPropagation(context);
+    if (isPuzzleValid(context)) { solveContextIteratively(context); }
+    context->difficulty = convertDifficultyScore(context->difficultyScore, context->order);
+    context->allocationCount = state->allocationCount;
+    context->status = solveStatus(context);
+    return context->status == MCSolveStatusSolved;
+}
+
+// generatePuzzleWithOrder, once the solve has begun on a newly created context.
+static void generatePuzzle(MCSudokuSolveContext *context, MCPuzzleDifficulty expectedDifficulty, uint64_t seed)
+{
+    if (expectedDifficulty == MCPuzzleDifficultyZero) { return; }
+    MCRandomState random;
+    seedRandom(&random, seed);
+    fillSolutionGrid(context, &random, context->solution);
+    context->solutionCount = 1;
+    memcpy(context->problem, context->solution, sizeof(uint) * context->cellCount);
+    removeNumbersFromBoard(context, expectedDifficulty, &random);
+    memcpy(context->board, context->problem, sizeof(uint) * context->cellCount);
+    int reason = isCancelled(&((MCSudokuSolveContextState *)context->opaque)->cancellation);
+    context->status = reason != 0 ? reason : MCSolveStatusSolved;
 }
 
+#pragma mark Private Functions - Context set up
+
 static MCSudokuSolveContext *createContextWithOrder(uint order)
 {
+    MCSudokuTopology *topology = retainTopology(order);
     MCSudokuSolveContext *context = malloc(sizeof(MCSudokuSolveContext));
+    context->topology = topology;
     context->difficultyScore = 0;
     context->difficulty = MCPuzzleDifficultyZero;
-    context->maxNumberForPencils = order * order;
+    context->maxNumberForPencils = topology->dimensionality;
     context->order = order;
-    context->dimensionality = context->maxNumberForPencils;
-    context->cellCount = context->dimensionality * context->dimensionality;
-    context->neighbourCount = order * (3 * order - 2) - 1;
+    context->dimensionality = topology->dimensionality;
+    context->cellCount = topology->cellCount;
+    context->neighbourCount = topology->neighbourCount;
+    context->pencilMarkWordCount = (context->maxNumberForPencils + MCPencilMarkWordBits - 1) / MCPencilMarkWordBits;
     context->solutionCount = 0;
+    context->guessCount = 0;
+    context->allocationCount = 0;
+    context->seed = 0;
+    context->budget = (MCSolveBudget){ 0, 0 };
+    context->status = MCSolveStatusNoSolution;
     
     context->problem = calloc(context->cellCount, sizeof(uint));
     context->solution = calloc(context->cellCount, sizeof(uint));
     context->board = calloc(context->cellCount, sizeof(uint));
     
-    context->boxMap = malloc(sizeof(uint*) * context->dimensionality);
-    context->rowMap = malloc(sizeof(uint*) * context->dimensionality);
-    context->columnMap = malloc(sizeof(uint*) * context->dimensionality);
-    context->boxMap[0] = malloc(sizeof(uint) * context->cellCount);
-    context->rowMap[0] = malloc(sizeof(uint) * context->cellCount);
-    context->columnMap[0] = malloc(sizeof(uint) * context->cellCount);
-    for (uint i = 1; i < context->dimensionality; i++) {
-        context->boxMap[i] = &context->boxMap[0][i * context->dimensionality];
-        context->rowMap[i] = &context->rowMap[0][i * context->dimensionality];
-        context->columnMap[i] = &context->columnMap[0][i * context->dimensionality];
-    }
+    context->boxMap = topology->boxMap;
+    context->rowMap = topology->rowMap;
+    context->columnMap = topology->columnMap;
+    context->neighbourMap = topology->neighbourMap;
+    context->pencilMarks = calloc(context->cellCount * context->pencilMarkWordCount, sizeof(MCPencilMarkWord));
+    context->opaque = createSolveState(context, 0);
+    return context;
+}
+
+#pragma mark Requests
+
+// The caller and the request's thread each hold a reference, whichever lets go last frees it.
+struct _MCSolveRequest {
+    MCSudokuSolveContext *context;
+    int isGenerating;
+    MCPuzzleDifficulty expectedDifficulty;
+    uint64_t seed;
+    MCSolveCompletion completion;
+    void *info;
+    int isBackground;               // Whether the thread that started the request spawned background tasks.
+    pthread_mutex_t lock;
+    int isFinished;                 // Set under lock once the solve is over, after which cancelling does nothing.
+    atomic_int referenceCount;
+};
+
+static void *runSolveRequest(void *argument)
+{
+    MCSolveRequest *request = argument;
+    setThreadSpawnsBackgroundTasks(request->isBackground);
+    if (request->isGenerating) { generatePuzzle(request->context, request->expectedDifficulty, request->seed); }
+    else { solveProblem(request->context); }
+    pthread_mutex_lock(&request->lock);
+    request->isFinished = 1;
+    pthread_mutex_unlock(&request->lock);
+    request->completion(request->context, request->info);
+    releaseSolveRequest(request);
+    return NULL;
+}
+
+// The solve must already have begun, so a cancel that comes in before the thread gets going isn't lost.
+static MCSolveRequest *startSolveRequest(MCSudokuSolveContext *context, int isGenerating,
+    MCPuzzleDifficulty expectedDifficulty, uint64_t seed, MCSolveCompletion completion, void *info)
+{
+    MCSolveRequest *request = malloc(sizeof(MCSolveRequest));
+    request->context = context;
+    request->isGenerating = isGenerating;
+    request->expectedDifficulty = expectedDifficulty;
+    request->seed = seed;
+    request->completion = completion;
+    request->info = info;
+    request->isBackground = threadSpawnsBackgroundTasks();
+    pthread_mutex_init(&request->lock, NULL);
+    request->isFinished = 0;
+    atomic_init(&request->referenceCount, 2);
     
-    context->neighbourMap = malloc(sizeof(uint*) * context->cellCount);
-    context->pencilMarks = malloc(sizeof(char*) * context->cellCount);
-    context->neighbourMap[0] = malloc(sizeof(uint) * context->neighbourCount * context->cellCount);
-    context->pencilMarks[0] = malloc(sizeof(char) * context->maxNumberForPencils * context->cellCount);
-    MCSudokuSolveContextStopSolve *stopSolve = malloc(sizeof(MCSudokuSolveContextStopSolve));
-    stopSolve->lock = dispatch_semaphore_create(1);
-    stopSolve->stopSolve = 0;
-    context->opaque = stopSolve;
-    for (uint i = 1; i < context->cellCount; i++) {
-        context->neighbourMap[i] = &context->neighbourMap[0][i * context->neighbourCount];
-        context->pencilMarks[i] = &context->pencilMarks[0][i * context->maxNumberForPencils];
+    pthread_t thread;
+    pthread_attr_t attributes;
+    pthread_attr_init(&attributes);
+    pthread_attr_setdetachstate(&attributes, PTHREAD_CREATE_DETACHED);
+    int error = pthread_create(&thread, &attributes, runSolveRequest, request);
+    pthread_attr_destroy(&attributes);
+    if (error != 0) {
+        pthread_mutex_destroy(&request->lock);
+        free(request);
+        return NULL;
     }
-    
-    setUpRegions(context);
-    setUpNeighbours(context);
-    return context;
+    return request;
 }
 
 #pragma mark Public Functions
@@ -883,21 +1821,12 @@ static MCSudokuSolveContext *createContextWithOrder(uint order)
 void destroyContext(MCSudokuSolveContext *context)
 {
     if (context == NULL) { return; }
-    dispatch_release(((MCSudokuSolveContextStopSolve *)context->opaque)->lock);
-    free(context->boxMap[0]);
-    free(context->rowMap[0]);
-    free(context->columnMap[0]);
-    free(context->neighbourMap[0]);
-    free(context->pencilMarks[0]);
+    destroySolveState(context->opaque);
+    releaseTopology(context->topology);
     free(context->problem);
     free(context->solution);
     free(context->board);
-    free(context->boxMap);
-    free(context->rowMap);
-    free(context->columnMap);
-    free(context->neighbourMap);
     free(context->pencilMarks);
-    free(context->opaque);
     free(context);
 }
 
@@ -905,23 +1834,155 @@ int solveContext(MCSudokuSolveContext *context)
 {
     if (context == NULL) { return 0; }
     if (context->problem == NULL) { return 0; }
+    beginSolve(context);
+    return solveProblem(context);
+}
+
+uint countSolutions(MCSudokuSolveContext *context, uint limit)
+{
+    if (context == NULL) { return 0; }
+    if (context->problem == NULL) { return 0; }
+    MCSudokuSolveContextState *state = context->opaque;
+    beginSolve(context);
     context->solutionCount = 0;
-    context->difficultyScore = 0;
-    memcpy(context->board, context->problem, sizeof(uint) * context->cellCount);
-    markup(context);
-    if (isPuzzleValid(context)) { solveContextRecursive(context); }
-    context->difficulty = convertDifficultyScore(context->difficultyScore, context->order);
+    context->guessCount = 0;
+    context->allocationCount = 0;
+    context->status = MCSolveStatusNoSolution;
+    if (limit == 0) { return 0; }
+    context->solutionCount = countSolutionsOfProblem(context, NULL, limit);
+    context->guessCount = state->counting->guessCount;
+    context->allocationCount = state->counting->allocationCount;
+    context->status = solveStatus(context);
+    return context->solutionCount;
+}
+
+uint enumerateSolutions(MCSudokuSolveContext *context, uint limit, MCSolutionCallback callback, void *info)
+{
+    if (context == NULL) { return 0; }
+    if (context->problem == NULL || callback == NULL) { return 0; }
+    MCSudokuSolveContextState *state = context->opaque;
+    beginSolve(context);
+    context->solutionCount = 0;
+    context->guessCount = 0;
+    context->allocationCount = 0;
+    context->status = MCSolveStatusNoSolution;
+    if (limit == 0) { return 0; }
+    
+    MCSudokuSearch search;
+    initSearch(&search, context, state);
+    search.callback = callback;
+    search.callbackInfo = info;
+    search.limit = limit;
+    countSolutionsOfProblem(context, &search, UINT_MAX);
+    waitForTaskGroup(&search.branches);
+    context->solutionCount = search.solutionCount;
+    context->guessCount = state->counting->guessCount + atomic_load(&search.guessCount);
+    context->allocationCount = state->counting->allocationCount + atomic_load(&search.allocationCount);
+    context->status = solveStatus(context);
+    pthread_mutex_destroy(&search.lock);
+    return context->solutionCount;
+}
+
+int solveContextExactCover(MCSudokuSolveContext *context)
+{
+    if (context == NULL) { return 0; }
+    if (context->problem == NULL) { return 0; }
+    context->solutionCount = countExactCoverSolutions(context, context->problem, context->solution, 2,
+        &context->guessCount);
+    context->status = context->solutionCount == 0 ? MCSolveStatusNoSolution :
+        context->solutionCount == 1 ? MCSolveStatusSolved : MCSolveStatusMultipleSolutions;
     return context->solutionCount == 1;
 }
 
-MCSudokuSolveContext *generatePuzzleWithOrder(uint order, MCPuzzleDifficulty expectedDifficulty)
+void cancelSolve(MCSudokuSolveContext *context)
+{
+    if (context == NULL) { return; }
+    cancelToken(&((MCSudokuSolveContextState *)context->opaque)->cancellation, MCSolveStatusCancelled);
+}
+
+MCSudokuSolveContext *createContext(uint order)
+{
+    if (order == 0) { return NULL; }
+    return createContextWithOrder(order);
+}
+
+void resetContext(MCSudokuSolveContext *context)
+{
+    if (context == NULL) { return; }
+    memset(context->problem, 0, sizeof(uint) * context->cellCount);
+    memset(context->solution, 0, sizeof(uint) * context->cellCount);
+    memset(context->board, 0, sizeof(uint) * context->cellCount);
+    memset(context->pencilMarks, 0, sizeof(MCPencilMarkWord) * context->cellCount * context->pencilMarkWordCount);
+    context->solutionCount = 0;
+    context->difficultyScore = 0;
+    context->guessCount = 0;
+    context->allocationCount = 0;
+    context->difficulty = MCPuzzleDifficultyZero;
+    context->status = MCSolveStatusNoSolution;
+}
+
+MCSudokuSolveContext *generatePuzzleWithOrder(uint order, MCPuzzleDifficulty expectedDifficulty, uint64_t seed)
 {
     if (order == 0) { return NULL; }
     MCSudokuSolveContext *context = createContextWithOrder(order);
-    if (expectedDifficulty == MCPuzzleDifficultyZero) { return context; }
-    solveContext(context);
-    memcpy(context->problem, context->solution, sizeof(uint) * context->cellCount);
-    removeNumbersFromBoard(context, expectedDifficulty);
+    beginSolve(context);
+    generatePuzzle(context, expectedDifficulty, seed);
+    return context;
+}
+
+MCSudokuSolveContext *createIsomorphicPuzzle(const MCSudokuSolveContext *puzzle, uint64_t seed)
+{
+    if (puzzle == NULL) { return NULL; }
+    MCSudokuSolveContext *context = createContextWithOrder(puzzle->order);
+    MCRandomState random;
+    seedRandom(&random, seed);
+    MCSudokuTransform *transform = createTransform(puzzle->order);
+    randomizeTransform(transform, &random);
+    applyTransform(transform, puzzle->problem, context->problem);
+    applyTransform(transform, puzzle->solution, context->solution);
+    destroyTransform(transform);
     memcpy(context->board, context->problem, sizeof(uint) * context->cellCount);
+    context->seed = puzzle->seed;
+    context->solutionCount = puzzle->solutionCount;
+    context->difficultyScore = puzzle->difficultyScore;
+    context->difficulty = puzzle->difficulty;
+    context->status = puzzle->status;
     return context;
 }
+
+MCSolveRequest *solveContextAsync(MCSudokuSolveContext *context, MCSolveCompletion completion, void *info)
+{
+    if (context == NULL || completion == NULL) { return NULL; }
+    if (context->problem == NULL) { return NULL; }
+    beginSolve(context);
+    return startSolveRequest(context, 0, MCPuzzleDifficultyZero, 0, completion, info);
+}
+
+MCSolveRequest *generatePuzzleAsync(uint order, MCPuzzleDifficulty expectedDifficulty, uint64_t seed,
+    MCSolveBudget budget, MCSolveCompletion completion, void *info)
+{
+    if (order == 0 || completion == NULL) { return NULL; }
+    MCSudokuSolveContext *context = createContextWithOrder(order);
+    context->budget = budget;
+    beginSolve(context);
+    MCSolveRequest *request = startSolveRequest(context, 1, expectedDifficulty, seed, completion, info);
+    if (request == NULL) { destroyContext(context); }
+    return request;
+}
+
+void cancelSolveRequest(MCSolveRequest *request)
+{
+    if (request == NULL) { return; }
+    pthread_mutex_lock(&request->lock);
+    if (!request->isFinished) { cancelSolve(request->context); }
+    pthread_mutex_unlock(&request->lock);
+}
+
+void releaseSolveRequest(MCSolveRequest *request)
+{
+    if (request == NULL) { return; }
+    if (atomic_fetch_sub(&request->referenceCount, 1) == 1) {
+        pthread_mutex_destroy(&request->lock);
+        free(request);
+    }
+}
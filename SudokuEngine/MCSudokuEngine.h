@@ -10,6 +10,8 @@
 #define MCSudokuEngine_h
 
 #include <pthread.h>
+#include <stdint.h>
+#include <sys/types.h>
 
 typedef enum {
     MCPuzzleDifficultyZero = 0,
@@ -19,36 +21,134 @@ typedef enum {
     MCPuzzleDifficultyInsane/*InTheMembrane*/ = 85
 } MCPuzzleDifficulty;
 
+// Pencil marks are stored as a bitmask per cell, bit (n - 1) being set when n is a candidate. Orders up to 8 fit a
+// cell in a single word, larger orders use pencilMarkWordCount consecutive words per cell.
+typedef uint64_t MCPencilMarkWord;
+
+// How the last solve of a context ended. A solve that was stopped early says why rather than what it had found.
+typedef enum {
+    MCSolveStatusNoSolution = 0,
+    MCSolveStatusSolved,
+    MCSolveStatusMultipleSolutions,
+    MCSolveStatusCancelled,         // Stopped by cancelSolve or cancelSolveRequest.
+    MCSolveStatusOverBudget         // Stopped by the context's budget running out.
+} MCSolveStatus;
+
+// Limits on how much work a solve may do, 0 meaning no limit. They are checked as the solve goes, so it can run a
+// little over before it notices.
+typedef struct _MCSolveBudget {
+    double seconds;         // Wall clock time, counted from the start of the solve.
+    uint guessLimit;        // Guesses tried, across every branch of the search.
+} MCSolveBudget;
+
 typedef struct _MCSudokuSolveContext {
-    // These values should be readonly once the context has been set up.
+    // These values should be readonly once the context has been set up. The maps are shared with other contexts.
     uint cellCount;
     uint maxNumberForPencils;
     uint order;
     uint dimensionality;
     uint neighbourCount;
+    uint pencilMarkWordCount;
     
     uint **boxMap;          // boxMap[dimensionality][dimensionality]
     uint **columnMap;       // columnMap[dimensionality][dimensionality]
     uint **rowMap;          // rowMap[dimensionality][dimensionality]
     uint **neighbourMap;    // neighbourMap[cellCount][neighbourCount]
+    struct _MCSudokuTopology *topology;     // Owns the maps
     
     // Variables
+    uint64_t seed;          // Seeds the tie breaks made while solving, so a puzzle always gets the same score.
+    MCSolveBudget budget;   // Applies to every solve of the context, and to the whole of generating a puzzle.
+    MCSolveStatus status;
     uint solutionCount;
     uint difficultyScore;
+    uint guessCount;        // Guesses tried by the last solve, including any on branches that were abandoned.
+    uint allocationCount;   // Heap allocations made by the last solve once it had started, across all its branches.
     MCPuzzleDifficulty difficulty;
     
     uint *problem;          // problem[cellCount]
     uint *solution;         // solution[cellCount]
     uint *board;            // board[cellCount]
-    char **pencilMarks;     // pencilMarks[cellCount][maxNumberOfPencils] boolean values only.
+    MCPencilMarkWord *pencilMarks;  // pencilMarks[cellCount * pencilMarkWordCount]
     
     void *opaque;           // Private use
     
 } MCSudokuSolveContext;
 
-MCSudokuSolveContext *generatePuzzleWithOrder(uint order, MCPuzzleDifficulty expectedDifficulty);
+// Creates an empty context for solving puzzles of the given order. The region and neighbour maps are shared by every
+// context of the same order, so this only allocates the board state. Fill in problem, then solve as often as needed.
+MCSudokuSolveContext *createContext(uint order);
+
+// Clears problem, solution, board and the results of the last solve, ready for another puzzle.
+void resetContext(MCSudokuSolveContext *context);
+
+// The same order, difficulty and seed always generate the same puzzle. MCPuzzleDifficultyZero gives an empty context,
+// the same as createContext.
+MCSudokuSolveContext *generatePuzzleWithOrder(uint order, MCPuzzleDifficulty expectedDifficulty, uint64_t seed);
+
+// Creates a copy of puzzle with its numbers relabelled and its rows and columns reordered, picked by seed, so one
+// expensive puzzle can be handed out many times over without looking the same. The copy takes the same steps to
+// solve, just in different places, so puzzle's difficulty and difficultyScore are carried over. Grading the copy
+// again can give a slightly different score, as the techniques look over the board in a fixed order.
+MCSudokuSolveContext *createIsomorphicPuzzle(const MCSudokuSolveContext *puzzle, uint64_t seed);
+
+// Returns 1 if problem has a unique solution, which is graded. A solve that is cancelled or runs over budget returns
+// 0, with status saying which, and leaves whatever it had found by then: solutionCount, guessCount and, if a
+// solution turned up, solution.
 int solveContext(MCSudokuSolveContext *context);
 
+// Counts the solutions to problem, stopping once limit have been found: 1 is enough to tell whether there is a
+// solution and 2 whether it is unique. Nothing is graded, so difficultyScore and difficulty are left alone. Sets
+// solution to the first solution found, along with solutionCount, guessCount and allocationCount, and returns the
+// number of solutions found. Can be cancelled with cancelSolve, and status tells whether the count was cut short.
+uint countSolutions(MCSudokuSolveContext *context, uint limit);
+
+// Receives each solution found by enumerateSolutions. solution holds cellCount numbers and is only valid for the
+// duration of the call. Return 0 to stop the enumeration.
+typedef int (*MCSolutionCallback)(const uint *solution, void *info);
+
+// Passes the solutions to problem to callback as they are found, without keeping them, until limit have been passed
+// on or callback returns 0. UINT_MAX enumerates every solution. The search is spread over the task pool, so solutions
+// come in no particular order and callback may be called from any thread, though never from two at once. Nothing is
+// graded. Sets solution to the first solution passed on, along with solutionCount, guessCount and allocationCount,
+// and returns the number of solutions passed on. Can be cancelled with cancelSolve.
+uint enumerateSolutions(MCSudokuSolveContext *context, uint limit, MCSolutionCallback callback, void *info);
+
+// Solves problem without grading it, for when only the solution or whether there is exactly one matters. Sets
+// solution, solutionCount, guessCount and status, stopping once a second solution is found, and leaves
+// difficultyScore and difficulty alone. Returns 1 if the puzzle has a unique solution. Ignores the budget and can't be
+// cancelled.
+int solveContextExactCover(MCSudokuSolveContext *context);
+
+// Safe to call from any thread while solveContext is running on context. The solve stops at its next step and
+// returns 0, leaving solutionCount and difficultyScore incomplete. Solves started afterwards are unaffected.
+void cancelSolve(MCSudokuSolveContext *context);
+
+// A solve or puzzle generation running on a thread of its own. If the thread that starts it spawns background tasks,
+// as described in MCTaskScheduler.h, so does the request's.
+typedef struct _MCSolveRequest MCSolveRequest;
+
+// Called on the request's thread once it has finished, with the context it worked on, whose status says how it went.
+typedef void (*MCSolveCompletion)(MCSudokuSolveContext *context, void *info);
+
+// Solves context as solveContext would, without blocking. The budget is counted from this call, and context mustn't
+// be touched until completion has been called. Returns NULL, without calling completion, if no thread could be
+// started. Every request returned must be released with releaseSolveRequest.
+MCSolveRequest *solveContextAsync(MCSudokuSolveContext *context, MCSolveCompletion completion, void *info);
+
+// Generates a puzzle as generatePuzzleWithOrder would, without blocking, and passes it to completion, which is then
+// responsible for destroying it. If the request is stopped early the puzzle is the best found so far, which still
+// has a unique solution but may be easier than asked for, and status says why.
+MCSolveRequest *generatePuzzleAsync(uint order, MCPuzzleDifficulty expectedDifficulty, uint64_t seed,
+    MCSolveBudget budget, MCSolveCompletion completion, void *info);
+
+// Stops the request, which completes with MCSolveStatusCancelled unless it has already finished. Safe to call from
+// any thread, including from completion.
+void cancelSolveRequest(MCSolveRequest *request);
+
+// Gives up the caller's hold on the request. A request still running carries on, and frees itself once it is done.
+void releaseSolveRequest(MCSolveRequest *request);
+
 void destroyContext(MCSudokuSolveContext *context);
 
 #endif /* MCSudokuEngine_h */
@@ -37,6 +37,7 @@ public protocol SudokuBoardProtocol: NSObjectProtocol, NSCoding
     
     var isSolved: Bool { get }
     var isValid: Bool { get }
+    var solveStatus: SolveStatus? { get }
     
     func solve() -> Bool
     func markupBoard()
@@ -89,6 +90,54 @@ public enum PuzzleDifficulty: Int
     }
 }
 
+// MARK: - SolveStatus Enum
+// How a solve of a board ended.
+public enum SolveStatus
+{
+    case solved
+    case noSolution
+    case multipleSolutions
+    case cancelled
+    case overBudget
+    
+    fileprivate init(status: MCSolveStatus)
+    {
+        switch status {
+        case MCSolveStatusSolved:               self = .solved
+        case MCSolveStatusMultipleSolutions:    self = .multipleSolutions
+        case MCSolveStatusCancelled:            self = .cancelled
+        case MCSolveStatusOverBudget:           self = .overBudget
+        default:                                self = .noSolution
+        }
+    }
+    
+    // Whether the solve was stopped before it could tell how many solutions there are.
+    public var wasStopped: Bool {
+        return self == .cancelled || self == .overBudget
+    }
+}
+
+// MARK: - SolveBudget Struct
+// Limits on how much work a solve may do, 0 meaning no limit. The solve can run a little over before it notices.
+public struct SolveBudget
+{
+    public var seconds: TimeInterval
+    public var guessLimit: Int
+    
+    public static let unlimited = SolveBudget(seconds: 0)
+    
+    public init(seconds: TimeInterval, guessLimit: Int = 0)
+    {
+        self.seconds = seconds
+        self.guessLimit = guessLimit
+    }
+    
+    fileprivate func toMCSolveBudget() -> MCSolveBudget
+    {
+        return MCSolveBudget(seconds: seconds, guessLimit: CUnsignedInt(guessLimit))
+    }
+}
+
 // MARK: - Cell Implementation
 public class Cell: NSObject, NSCoding
 {
@@ -130,6 +179,15 @@ public class SudokuBoard: NSObject, SudokuBoardProtocol
     fileprivate let board: [Cell]
     private (set) public var difficulty = PuzzleDifficulty.blank
     private (set) public var difficultyScore = 0
+    private var engineContext: UnsafeMutablePointer<MCSudokuSolveContext>?
+    // Heap allocations made by the engine during the last call to solve(), for tests.
+    private (set) var solveAllocationCount = 0
+    
+    // Limits every solve of the board, so a puzzle typed in that needs a vast search can't hold up the caller for
+    // long. Generated puzzles solve well within it.
+    public var solveBudget = SolveBudget(seconds: 5)
+    // How the last solve ended, or nil if the board hasn't been solved.
+    private (set) public var solveStatus: SolveStatus?
  
     public var isSolved: Bool {
         return difficulty.isSolvable() && !board.contains(where: { $0.number != $0.solution } )
@@ -157,11 +215,17 @@ public class SudokuBoard: NSObject, SudokuBoardProtocol
     
     // MARK: - Class Functions
     public class func generatePuzzle(ofOrder order: Int, difficulty: PuzzleDifficulty) -> SudokuBoard?
+    {
+        return generatePuzzle(ofOrder: order, difficulty: difficulty, seed: UInt64.random(in: 0 ... UInt64.max))
+    }
+    
+    // The same order, difficulty and seed always give the same puzzle.
+    public class func generatePuzzle(ofOrder order: Int, difficulty: PuzzleDifficulty, seed: UInt64) -> SudokuBoard?
     {
         if [.multipleSolutions, .noSolution].contains(difficulty) { return nil }
         let cOrder = CUnsignedInt(order)
         let cDifficulty = difficulty.toMCPuzzleDifficulty()
-        if let puzzle = generatePuzzleWithOrder(cOrder, cDifficulty) {
+        if let puzzle = generatePuzzleWithOrder(cOrder, cDifficulty, seed) {
             defer { destroyContext(puzzle) }
             return SudokuBoard(withPuzzle: puzzle.pointee)
         }
@@ -171,22 +235,56 @@ public class SudokuBoard: NSObject, SudokuBoardProtocol
     // MARK: - Public Functions
     public func solve() -> Bool
     {
-        var context = generatePuzzleWithOrder(CUnsignedInt(order), MCPuzzleDifficultyZero)!
-        defer { destroyContext(context) }
+        let context = resetEngineContext()
+        context.pointee.budget = solveBudget.toMCSolveBudget()
+        loadProblem(into: context, givensOnly: false)
+        solveAllocationCount = 0
+        defer { solveAllocationCount += Int(context.pointee.allocationCount) }
+        if solveContext(context) == 0 && !SolveStatus(status: context.pointee.status).wasStopped {
+            solveAllocationCount += Int(context.pointee.allocationCount)
+            loadProblem(into: context, givensOnly: true)
+            solveContext(context)
+        }
+        return finishSolve(context)
+    }
+    
+    // Solves the board on a thread of its own, as solve() would, then calls completion on the main queue with the
+    // result. The board mustn't be changed or solved again until then. Returns nil if no thread could be started.
+    @discardableResult
+    public func solve(completion: @escaping (Bool) -> Void) -> SolveRequest?
+    {
+        let context = resetEngineContext()
+        context.pointee.budget = solveBudget.toMCSolveBudget()
+        loadProblem(into: context, givensOnly: false)
+        let givens = board.map { CUnsignedInt($0.isGiven ? $0.number ?? 0 : 0) }
+        let request = SolveRequest(board: self, context: context, givens: givens, completion: completion)
+        return request.start() ? request : nil
+    }
+    
+    public func hasUniqueSolution() -> Bool
+    {
+        let context = resetEngineContext()
         for (i, cell) in board.enumerated() { context.pointee.problem[i] = CUnsignedInt(cell.number ?? 0) }
-        if solveContext(context) == 0 {
-            for (i, cell) in board.enumerated() {
-                context.pointee.problem[i] = cell.isGiven ? CUnsignedInt(cell.number ?? 0) : 0
-            }
-            if solveContext(context) == 0 {
-                difficulty = context.pointee.solutionCount > 0 ? .multipleSolutions : .noSolution
-                return false
-            }
+        return countSolutions(context, 2) == 1
+    }
+    
+    // The same puzzle with its numbers relabelled and its rows and columns reordered. It looks nothing like this one
+    // but is just as hard. Only boards with a puzzle set have one.
+    public func isomorph(seed: UInt64) -> SudokuBoard?
+    {
+        if [.blank, .multipleSolutions, .noSolution].contains(difficulty) { return nil }
+        let context = resetEngineContext()
+        for (i, cell) in board.enumerated() {
+            context.pointee.problem[i] = cell.isGiven ? CUnsignedInt(cell.number ?? 0) : 0
+            context.pointee.solution[i] = CUnsignedInt(cell.solution ?? 0)
         }
-        for (i, cell) in board.enumerated() { cell.solution = Int(context.pointee.solution[i]) }
-        difficulty = PuzzleDifficulty(difficulty: context.pointee.difficulty)
-        difficultyScore = Int(context.pointee.difficultyScore)
-        return true
+        context.pointee.difficulty = difficulty.toMCPuzzleDifficulty()
+        context.pointee.difficultyScore = CUnsignedInt(difficultyScore)
+        if let puzzle = createIsomorphicPuzzle(context, seed) {
+            defer { destroyContext(puzzle) }
+            return SudokuBoard(withPuzzle: puzzle.pointee)
+        }
+        return nil
     }
     
     public func markupBoard()
@@ -254,7 +352,7 @@ public class SudokuBoard: NSObject, SudokuBoardProtocol
             self.board = []
             return nil
         }
-        var context = generatePuzzleWithOrder(CUnsignedInt(order), MCPuzzleDifficultyZero)!
+        let context = createContext(CUnsignedInt(order))!
         defer { destroyContext(context) }
         self.order = order
         self.dimensionality = order * order
@@ -294,12 +392,53 @@ public class SudokuBoard: NSObject, SudokuBoardProtocol
     deinit
     {
         board.forEach { $0.neighbours.removeAll() }
+        if let context = engineContext { destroyContext(context) }
     }
 }
 
 // MARK: - SudokuBoard Private Functions
 fileprivate extension SudokuBoard
 {
+    // Solves reuse one context per board, created on first use.
+    func resetEngineContext() -> UnsafeMutablePointer<MCSudokuSolveContext>
+    {
+        if let context = engineContext {
+            resetContext(context)
+            return context
+        }
+        let context = createContext(CUnsignedInt(order))!
+        engineContext = context
+        return context
+    }
+    
+    // Fills in the context's problem from the board, leaving out numbers that aren't given if givensOnly is set.
+    func loadProblem(into context: UnsafeMutablePointer<MCSudokuSolveContext>, givensOnly: Bool)
+    {
+        for (i, cell) in board.enumerated() {
+            let number = givensOnly && !cell.isGiven ? 0 : cell.number ?? 0
+            context.pointee.problem[i] = CUnsignedInt(number)
+        }
+    }
+    
+    // Takes the results of the last solve of context, returning whether it found a unique solution. A solve that was
+    // stopped leaves the board as it was.
+    func finishSolve(_ context: UnsafeMutablePointer<MCSudokuSolveContext>) -> Bool
+    {
+        let status = SolveStatus(status: context.pointee.status)
+        solveStatus = status
+        switch status {
+        case .solved:
+            for (i, cell) in board.enumerated() { cell.solution = Int(context.pointee.solution[i]) }
+            difficulty = PuzzleDifficulty(difficulty: context.pointee.difficulty)
+            difficultyScore = Int(context.pointee.difficultyScore)
+            return true
+        case .noSolution:               difficulty = .noSolution
+        case .multipleSolutions:        difficulty = .multipleSolutions
+        case .cancelled, .overBudget:   break
+        }
+        return false
+    }
+    
     func isCellValid(_ cell: Cell) -> Bool
     {
         for neighbour in cell.neighbours.compactMap( { cellAt($0) } ) {
@@ -359,3 +498,163 @@ extension SudokuBoard
         }
     }
 }
+
+// MARK: - SolveRequest Implementation
+// A solve started by SudokuBoard.solve(completion:), running on a thread of its own. The request keeps itself and
+// the board alive until the solve has finished.
+public class SolveRequest
+{
+    private let board: SudokuBoard
+    private let context: UnsafeMutablePointer<MCSudokuSolveContext>
+    private let givens: [CUnsignedInt]
+    private let completion: (Bool) -> Void
+    private let lock = NSLock()
+    private var request: OpaquePointer?
+    private var isCancelled = false
+    private var isSolvingGivens = false
+    
+    fileprivate init(board: SudokuBoard, context: UnsafeMutablePointer<MCSudokuSolveContext>, givens: [CUnsignedInt],
+        completion: @escaping (Bool) -> Void)
+    {
+        self.board = board
+        self.context = context
+        self.givens = givens
+        self.completion = completion
+    }
+    
+    // Stops the solve, which then completes with false and the board's solveStatus set to .cancelled, unless it has
+    // already finished. Safe to call from any thread.
+    public func cancel()
+    {
+        lock.lock()
+        defer { lock.unlock() }
+        isCancelled = true
+        cancelSolveRequest(request)
+    }
+    
+    // Starts solving the context's problem, returning false if the request has been cancelled or no thread could be
+    // started.
+    fileprivate func start() -> Bool
+    {
+        lock.lock()
+        defer { lock.unlock() }
+        if isCancelled {
+            context.pointee.status = MCSolveStatusCancelled
+            return false
+        }
+        let info = Unmanaged.passRetained(self).toOpaque()
+        let request = solveContextAsync(context, { _, info in
+            Unmanaged<SolveRequest>.fromOpaque(info!).takeRetainedValue().solveFinished()
+        }, info)
+        if request == nil {
+            Unmanaged<SolveRequest>.fromOpaque(info).release()
+            return false
+        }
+        releaseSolveRequest(self.request)
+        self.request = request
+        return true
+    }
+    
+    // Called on the request's thread. As in solve(), numbers with no unique solution are solved again with just the
+    // givens.
+    private func solveFinished()
+    {
+        let status = SolveStatus(status: context.pointee.status)
+        if status != .solved && !status.wasStopped && !isSolvingGivens {
+            isSolvingGivens = true
+            for (i, number) in givens.enumerated() { context.pointee.problem[i] = number }
+            if start() { return }
+        }
+        DispatchQueue.main.async { self.completion(self.board.finishSolve(self.context)) }
+    }
+    
+    deinit
+    {
+        releaseSolveRequest(request)
+    }
+}
+
+// MARK: - PuzzleBank Implementation
+// Puzzles generated ahead of time by Tools/PuzzleBank. The file is mapped rather than read, so opening a bank is cheap
+// and taking a puzzle from it costs next to nothing.
+public class PuzzleBank
+{
+    private let bank: OpaquePointer
+    
+    public init?(contentsOf url: URL)
+    {
+        guard let bank = openPuzzleBank(url.path) else { return nil }
+        self.bank = bank
+    }
+    
+    public func count(ofOrder order: Int, difficulty: PuzzleDifficulty) -> Int
+    {
+        return Int(puzzleBankCount(bank, CUnsignedInt(order), difficulty.toMCPuzzleDifficulty()))
+    }
+    
+    public func puzzle(ofOrder order: Int, difficulty: PuzzleDifficulty) -> SudokuBoard?
+    {
+        return puzzle(ofOrder: order, difficulty: difficulty, seed: UInt64.random(in: 0 ... UInt64.max))
+    }
+    
+    // seed picks the puzzle and how it is relabelled and reordered. Returns nil if the bank has no puzzles of that
+    // order and difficulty.
+    public func puzzle(ofOrder order: Int, difficulty: PuzzleDifficulty, seed: UInt64) -> SudokuBoard?
+    {
+        if !difficulty.isSolvable() { return nil }
+        let cDifficulty = difficulty.toMCPuzzleDifficulty()
+        if let puzzle = createPuzzleFromBank(bank, CUnsignedInt(order), cDifficulty, seed) {
+            defer { destroyContext(puzzle) }
+            return SudokuBoard(withPuzzle: puzzle.pointee)
+        }
+        return nil
+    }
+    
+    deinit
+    {
+        closePuzzleBank(bank)
+    }
+}
+
+// MARK: - PuzzlePool Implementation
+// Keeps a few puzzles of each difficulty generated in the background, topping itself up as they are taken.
+public class PuzzlePool
+{
+    public let order: Int
+    private let pool: OpaquePointer
+    
+    public var hitCount: Int { return Int(puzzlePoolStatistics(pool).hitCount) }
+    public var missCount: Int { return Int(puzzlePoolStatistics(pool).missCount) }
+    public var refillCount: Int { return Int(puzzlePoolStatistics(pool).refillCount) }
+    
+    // How long generating a puzzle in the background takes on average, or 0 before the first has been generated.
+    public var averageRefillTime: TimeInterval {
+        let statistics = puzzlePoolStatistics(pool)
+        return statistics.refillCount > 0 ? statistics.refillSeconds / Double(statistics.refillCount) : 0
+    }
+    
+    public init?(order: Int, capacity: Int)
+    {
+        let seed = UInt64.random(in: 0 ... UInt64.max)
+        guard order > 1, capacity > 0,
+            let pool = createPuzzlePool(CUnsignedInt(order), CUnsignedInt(capacity), seed) else { return nil }
+        self.order = order
+        self.pool = pool
+    }
+    
+    // A puzzle that is ready if there is one, otherwise one generated while the caller waits.
+    public func puzzle(difficulty: PuzzleDifficulty) -> SudokuBoard?
+    {
+        if !difficulty.isSolvable() { return nil }
+        if let puzzle = takePuzzleFromPool(pool, difficulty.toMCPuzzleDifficulty()) {
+            defer { destroyContext(puzzle) }
+            return SudokuBoard(withPuzzle: puzzle.pointee)
+        }
+        return nil
+    }
+    
+    deinit
+    {
+        destroyPuzzlePool(pool)
+    }
+}
@@ -0,0 +1,193 @@
+//
+//  MCSudokuTopology.c
+//  Sudoku++
+//
+//  Created by Maarut Chandegra on 17/10/2026.
+//  Copyright © 2026 Maarut Chandegra. All rights reserved.
+//
+
+#include "MCSudokuTopology.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#pragma mark Static Storage
+
+// Every map for an order is carved out of one block of cells and one block of row pointers.
+#define MCTopologyCellCount(order) \
+    ((order) * (order) * (order) * (order) * (6 + (order) * (3 * (order) - 2) - 1) + 2 * (order) * (order) * (order))
+#define MCTopologyRowCount(order) (5 * (order) * (order) + (order) * (order) * (order) * (order))
+
+#define MCStaticTopologyCellCount \
+    (MCTopologyCellCount(2) + MCTopologyCellCount(3) + MCTopologyCellCount(4) + MCTopologyCellCount(5))
+#define MCStaticTopologyRowCount \
+    (MCTopologyRowCount(2) + MCTopologyRowCount(3) + MCTopologyRowCount(4) + MCTopologyRowCount(5))
+
+static uint staticTopologyCells[MCStaticTopologyCellCount];
+static uint *staticTopologyRows[MCStaticTopologyRowCount];
+static MCSudokuTopology staticTopologies[MCStaticTopologyMaxOrder + 1];
+static atomic_int staticTopologyIsReady[MCStaticTopologyMaxOrder + 1];
+
+static MCSudokuTopology *allocatedTopologies = NULL;
+static pthread_mutex_t topologyLock = PTHREAD_MUTEX_INITIALIZER;
+
+#pragma mark Building Maps
+
+static void setUpRegions(MCSudokuTopology *topology)
+{
+    for (int i = 0; i < topology->cellCount; i++) {
+        int row = i / topology->dimensionality;
+        int column = i % topology->dimensionality;
+        int box = (row / topology->order) * topology->order + (column / topology->order);
+
+        topology->rowMap[row][column] = i;
+        topology->columnMap[column][row] = i;
+        topology->boxMap[box][(row % topology->order) * topology->order + (column % topology->order)] = i;
+        topology->cellRow[i] = row;
+        topology->cellColumn[i] = column;
+        topology->cellBox[i] = box;
+    }
+    for (uint box = 0; box < topology->dimensionality; box++) {
+        for (uint i = 0; i < topology->order; i++) {
+            topology->boxRowMap[box][i] = (box / topology->order) * topology->order + i;
+            topology->boxColumnMap[box][i] = (box % topology->order) * topology->order + i;
+        }
+    }
+}
+
+static void setUpNeighbours(MCSudokuTopology *topology)
+{
+    char *indexSet = malloc(sizeof(char) * topology->cellCount);
+    for (int i = 0; i < topology->cellCount; i++) {
+        memset(indexSet, 0, sizeof(char) * topology->cellCount);
+        uint row = i / topology->dimensionality;
+        uint column = i % topology->dimensionality;
+        uint box = (row / topology->order) * topology->order + (column / topology->order);
+
+        for (int j = 0; j < topology->dimensionality; j++) {
+            uint rowIndex = topology->rowMap[row][j],
+            colIndex = topology->columnMap[column][j],
+            boxIndex = topology->boxMap[box][j];
+            indexSet[rowIndex] = rowIndex != i;
+            indexSet[colIndex] = colIndex != i;
+            indexSet[boxIndex] = boxIndex != i;
+        }
+
+        int neighbourIndex = 0;
+        for (uint j = 0; j < topology->cellCount; j++) {
+            if (indexSet[j]) {
+                topology->neighbourMap[i][neighbourIndex++] = j;
+            }
+        }
+    }
+    free(indexSet);
+}
+
+// rows and cells must hold MCTopologyRowCount(order) and MCTopologyCellCount(order) entries.
+static void setUpTopology(MCSudokuTopology *topology, uint order, uint **rows, uint *cells)
+{
+    topology->order = order;
+    topology->dimensionality = order * order;
+    topology->cellCount = topology->dimensionality * topology->dimensionality;
+    topology->neighbourCount = order * (3 * order - 2) - 1;
+    atomic_init(&topology->referenceCount, 1);
+    topology->next = NULL;
+
+    topology->boxMap = rows;
+    topology->rowMap = rows + topology->dimensionality;
+    topology->columnMap = rows + topology->dimensionality * 2;
+    topology->neighbourMap = rows + topology->dimensionality * 3;
+    topology->boxRowMap = topology->neighbourMap + topology->cellCount;
+    topology->boxColumnMap = topology->boxRowMap + topology->dimensionality;
+    for (uint i = 0; i < topology->dimensionality; i++) {
+        topology->boxMap[i] = cells + i * topology->dimensionality;
+        topology->rowMap[i] = cells + (topology->dimensionality + i) * topology->dimensionality;
+        topology->columnMap[i] = cells + (topology->dimensionality * 2 + i) * topology->dimensionality;
+    }
+    uint *neighbours = cells + topology->cellCount * 3;
+    for (uint i = 0; i < topology->cellCount; i++) {
+        topology->neighbourMap[i] = neighbours + i * topology->neighbourCount;
+    }
+    topology->cellRow = neighbours + topology->cellCount * topology->neighbourCount;
+    topology->cellColumn = topology->cellRow + topology->cellCount;
+    topology->cellBox = topology->cellColumn + topology->cellCount;
+    uint *boxLines = topology->cellBox + topology->cellCount;
+    for (uint i = 0; i < topology->dimensionality; i++) {
+        topology->boxRowMap[i] = boxLines + i * topology->order;
+        topology->boxColumnMap[i] = boxLines + (topology->dimensionality + i) * topology->order;
+    }
+
+    setUpRegions(topology);
+    setUpNeighbours(topology);
+}
+
+#pragma mark Finding Topologies
+
+static int isStaticOrder(uint order)
+{
+    return order >= 2 && order <= MCStaticTopologyMaxOrder;
+}
+
+static MCSudokuTopology *staticTopology(uint order)
+{
+    MCSudokuTopology *topology = &staticTopologies[order];
+    if (atomic_load_explicit(&staticTopologyIsReady[order], memory_order_acquire)) { return topology; }
+
+    pthread_mutex_lock(&topologyLock);
+    if (!atomic_load_explicit(&staticTopologyIsReady[order], memory_order_relaxed)) {
+        uint **rows = staticTopologyRows;
+        uint *cells = staticTopologyCells;
+        for (uint i = 2; i < order; i++) {
+            rows += MCTopologyRowCount(i);
+            cells += MCTopologyCellCount(i);
+        }
+        setUpTopology(topology, order, rows, cells);
+        atomic_store_explicit(&staticTopologyIsReady[order], 1, memory_order_release);
+    }
+    pthread_mutex_unlock(&topologyLock);
+    return topology;
+}
+
+static MCSudokuTopology *allocatedTopology(uint order)
+{
+    pthread_mutex_lock(&topologyLock);
+    MCSudokuTopology *topology = allocatedTopologies;
+    while (topology != NULL && topology->order != order) { topology = topology->next; }
+    if (topology != NULL) {
+        atomic_fetch_add(&topology->referenceCount, 1);
+    }
+    else {
+        topology = malloc(sizeof(MCSudokuTopology));
+        setUpTopology(topology, order, malloc(sizeof(uint*) * MCTopologyRowCount(order)),
+            malloc(sizeof(uint) * MCTopologyCellCount(order)));
+        topology->next = allocatedTopologies;
+        allocatedTopologies = topology;
+    }
+    pthread_mutex_unlock(&topologyLock);
+    return topology;
+}
+
+#pragma mark Public Functions
+
+MCSudokuTopology *retainTopology(uint order)
+{
+    if (order == 0) { return NULL; }
+    return isStaticOrder(order) ? staticTopology(order) : allocatedTopology(order);
+}
+
+void releaseTopology(MCSudokuTopology *topology)
+{
+    if (topology == NULL || isStaticOrder(topology->order)) { return; }
+
+    // Taking the lock keeps the count from going back up between reaching zero and being unlinked.
+    pthread_mutex_lock(&topologyLock);
+    if (atomic_fetch_sub(&topology->referenceCount, 1) == 1) {
+        MCSudokuTopology **link = &allocatedTopologies;
+        while (*link != topology) { link = &(*link)->next; }
+        *link = topology->next;
+        free(topology->boxMap[0]);
+        free(topology->boxMap);
+        free(topology);
+    }
+    pthread_mutex_unlock(&topologyLock);
+}
@@ -0,0 +1,47 @@
+//
+//  MCSudokuTopology.h
+//  Sudoku++
+//
+//  Created by Maarut Chandegra on 17/10/2026.
+//  Copyright © 2026 Maarut Chandegra. All rights reserved.
+//
+
+#ifndef MCSudokuTopology_h
+#define MCSudokuTopology_h
+
+#include <stdatomic.h>
+#include <sys/types.h>
+
+// The region and neighbour maps for an order. They never change once built, so there is at most one per order in
+// the process, shared by every context of that order. Orders 2 to MCStaticTopologyMaxOrder live in static storage
+// and are never freed, other orders are allocated on demand and freed when the last context using them goes.
+
+#define MCStaticTopologyMaxOrder 5
+
+typedef struct _MCSudokuTopology {
+    uint order;
+    uint dimensionality;
+    uint cellCount;
+    uint neighbourCount;
+
+    uint **boxMap;          // boxMap[dimensionality][dimensionality]
+    uint **columnMap;       // columnMap[dimensionality][dimensionality]
+    uint **rowMap;          // rowMap[dimensionality][dimensionality]
+    uint **neighbourMap;    // neighbourMap[cellCount][neighbourCount]
+    uint **boxRowMap;       // boxRowMap[dimensionality][order], the rows through each box, top to bottom
+    uint **boxColumnMap;    // boxColumnMap[dimensionality][order], the columns through each box, left to right
+
+    uint *cellRow;          // cellRow[cellCount]
+    uint *cellColumn;       // cellColumn[cellCount]
+    uint *cellBox;          // cellBox[cellCount]
+
+    atomic_uint referenceCount;     // Only used by allocated topologies.
+    struct _MCSudokuTopology *next;
+} MCSudokuTopology;
+
+// Returns the topology for order, building it if this is the first time it has been asked for. Every call needs a
+// matching releaseTopology.
+MCSudokuTopology *retainTopology(uint order);
+void releaseTopology(MCSudokuTopology *topology);
+
+#endif /* MCSudokuTopology_h */
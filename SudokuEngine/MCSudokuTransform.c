@@ -0,0 +1,86 @@
+//
+//  MCSudokuTransform.c
+//  Sudoku++
+//
+//  Created by Maarut Chandegra on 17/10/2026.
+//  Copyright © 2026 Maarut Chandegra. All rights reserved.
+//
+
+#include "MCSudokuTransform.h"
+#include <stdlib.h>
+
+#pragma mark Shuffling
+
+// Fills values with 0 to count - 1 in random order.
+static void shuffle(MCRandomState *random, uint *values, uint count)
+{
+    for (uint i = 0; i < count; i++) { values[i] = i; }
+    for (uint i = count - 1; i > 0; i--) {
+        uint j = randomBelow(random, i + 1);
+        uint value = values[i];
+        values[i] = values[j];
+        values[j] = value;
+    }
+}
+
+// A random order for the rows or columns of a grid that keeps each band or stack together.
+static void shuffleLines(MCRandomState *random, uint order, uint *lines, uint *bands)
+{
+    shuffle(random, bands, order);
+    for (uint band = 0; band < order; band++) {
+        shuffle(random, lines + band * order, order);
+        for (uint i = 0; i < order; i++) { lines[band * order + i] += bands[band] * order; }
+    }
+}
+
+#pragma mark Public Functions
+
+MCSudokuTransform *createTransform(uint order)
+{
+    if (order == 0) { return NULL; }
+    uint dimensionality = order * order;
+    MCSudokuTransform *transform = malloc(sizeof(MCSudokuTransform) + sizeof(uint) * (dimensionality * 3 + 1));
+    transform->order = order;
+    transform->dimensionality = dimensionality;
+    transform->numbers = (uint *)(transform + 1);
+    transform->rows = transform->numbers + dimensionality + 1;
+    transform->columns = transform->rows + dimensionality;
+    transform->isTransposed = 0;
+    for (uint i = 0; i <= dimensionality; i++) { transform->numbers[i] = i; }
+    for (uint i = 0; i < dimensionality; i++) {
+        transform->rows[i] = i;
+        transform->columns[i] = i;
+    }
+    return transform;
+}
+
+void destroyTransform(MCSudokuTransform *transform)
+{
+    free(transform);
+}
+
+void randomizeTransform(MCSudokuTransform *transform, MCRandomState *random)
+{
+    uint order = transform->order, dimensionality = transform->dimensionality;
+    uint *bands = malloc(sizeof(uint) * order);
+    shuffle(random, transform->numbers + 1, dimensionality);
+    for (uint i = 1; i <= dimensionality; i++) { transform->numbers[i]++; }
+    shuffleLines(random, order, transform->rows, bands);
+    shuffleLines(random, order, transform->columns, bands);
+    transform->isTransposed = randomBelow(random, 2);
+    free(bands);
+}
+
+void applyTransform(const MCSudokuTransform *transform, const uint *grid, uint *transformed)
+{
+    uint dimensionality = transform->dimensionality;
+    uint rowStride = transform->isTransposed ? 1 : dimensionality;
+    uint columnStride = transform->isTransposed ? dimensionality : 1;
+    for (uint row = 0; row < dimensionality; row++) {
+        const uint *line = grid + transform->rows[row] * rowStride;
+        for (uint column = 0; column < dimensionality; column++) {
+            uint number = line[transform->columns[column] * columnStride];
+            transformed[row * dimensionality + column] = transform->numbers[number];
+        }
+    }
+}
@@ -0,0 +1,38 @@
+//
+//  MCSudokuTransform.h
+//  Sudoku++
+//
+//  Created by Maarut Chandegra on 17/10/2026.
+//  Copyright © 2026 Maarut Chandegra. All rights reserved.
+//
+
+#ifndef MCSudokuTransform_h
+#define MCSudokuTransform_h
+
+#include "MCRandom.h"
+#include <sys/types.h>
+
+// The symmetries of a sudoku grid: relabelling the numbers, reordering the rows within each band and the bands
+// themselves, the same for columns and stacks, and reflecting about the main diagonal. Any combination of them turns
+// a puzzle into one that looks different but has the same solution, relabelled, and takes the same steps to solve.
+
+typedef struct _MCSudokuTransform {
+    uint order;
+    uint dimensionality;
+    uint *numbers;          // numbers[dimensionality + 1], what each number becomes. 0, an empty cell, stays 0.
+    uint *rows;             // rows[dimensionality], the row of the original each row is taken from
+    uint *columns;          // columns[dimensionality], the same for columns
+    int isTransposed;       // Rows and columns swap places before they are reordered.
+} MCSudokuTransform;
+
+// Creates the transform that leaves a grid as it is.
+MCSudokuTransform *createTransform(uint order);
+void destroyTransform(MCSudokuTransform *transform);
+
+// Picks one of the symmetries at random, each as likely as the next. The same random state always picks the same one.
+void randomizeTransform(MCSudokuTransform *transform, MCRandomState *random);
+
+// Writes the transformed grid, cellCount numbers, to transformed, which mustn't overlap grid.
+void applyTransform(const MCSudokuTransform *transform, const uint *grid, uint *transformed);
+
+#endif /* MCSudokuTransform_h */
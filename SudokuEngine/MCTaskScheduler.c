@@ -0,0 +1,280 @@
+//
+//  MCTaskScheduler.c
+//  Sudoku++
+//
+//  Created by Maarut Chandegra on 17/10/2026.
+//  Copyright © 2026 Maarut Chandegra. All rights reserved.
+//
+
+#include "MCTaskScheduler.h"
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#pragma mark Typedefs
+
+typedef struct _MCTask {
+    MCTaskFunction function;
+    void *argument;
+    MCTaskGroup *group;
+    int isBackground;
+} MCTask;
+
+// Owners push and pop at the tail, thieves take from the head.
+typedef struct _MCTaskDeque {
+    pthread_mutex_t lock;
+    MCTask *tasks;
+    uint head;
+    uint count;
+    uint capacity;
+} MCTaskDeque;
+
+typedef struct _MCTaskScheduler {
+    uint workerCount;
+    MCTaskDeque *deques;        // deques[workerCount + 1], the last one is shared by threads outside the pool.
+    MCTaskDeque background;     // Background tasks from every thread.
+    pthread_key_t workerKey;    // Holds the worker's index + 1, unset on other threads.
+    pthread_key_t backgroundKey; // Set while the thread spawns background tasks.
+    pthread_mutex_t sleepLock;
+    pthread_cond_t wakeUp;
+    atomic_uint queuedTasks;
+    atomic_uint idleThreads;
+} MCTaskScheduler;
+
+static MCTaskScheduler scheduler;
+static pthread_once_t schedulerOnce = PTHREAD_ONCE_INIT;
+
+#pragma mark Deques
+
+static void initDeque(MCTaskDeque *deque)
+{
+    pthread_mutex_init(&deque->lock, NULL);
+    deque->head = 0;
+    deque->count = 0;
+    deque->capacity = 64;
+    deque->tasks = malloc(sizeof(MCTask) * deque->capacity);
+}
+
+static void pushTask(MCTaskDeque *deque, MCTask task)
+{
+    pthread_mutex_lock(&deque->lock);
+    if (deque->count == deque->capacity) {
+        MCTask *tasks = malloc(sizeof(MCTask) * deque->capacity * 2);
+        for (uint i = 0; i < deque->count; i++) {
+            tasks[i] = deque->tasks[(deque->head + i) % deque->capacity];
+        }
+        free(deque->tasks);
+        deque->tasks = tasks;
+        deque->head = 0;
+        deque->capacity *= 2;
+    }
+    deque->tasks[(deque->head + deque->count++) % deque->capacity] = task;
+    atomic_fetch_add(&task.group->queuedTasks, 1);
+    atomic_fetch_add(&scheduler.queuedTasks, 1);
+    pthread_mutex_unlock(&deque->lock);
+}
+
+// Called with the deque locked.
+static void didTakeTask(MCTask *task)
+{
+    atomic_fetch_sub(&task->group->queuedTasks, 1);
+    atomic_fetch_sub(&scheduler.queuedTasks, 1);
+}
+
+static int popTask(MCTaskDeque *deque, MCTask *task)
+{
+    int didPop = 0;
+    pthread_mutex_lock(&deque->lock);
+    if (deque->count > 0) {
+        *task = deque->tasks[(deque->head + --deque->count) % deque->capacity];
+        didTakeTask(task);
+        didPop = 1;
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return didPop;
+}
+
+static int stealTask(MCTaskDeque *deque, MCTask *task)
+{
+    int didSteal = 0;
+    pthread_mutex_lock(&deque->lock);
+    if (deque->count > 0) {
+        *task = deque->tasks[deque->head];
+        deque->head = (deque->head + 1) % deque->capacity;
+        deque->count--;
+        didTakeTask(task);
+        didSteal = 1;
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return didSteal;
+}
+
+// Takes the newest task of group from the deque if fromTail is set, otherwise the oldest, closing the gap it leaves.
+static int takeGroupTask(MCTaskDeque *deque, MCTaskGroup *group, int fromTail, MCTask *task)
+{
+    int didTake = 0;
+    pthread_mutex_lock(&deque->lock);
+    for (uint i = 0; i < deque->count && !didTake; i++) {
+        uint position = fromTail ? deque->count - 1 - i : i;
+        if (deque->tasks[(deque->head + position) % deque->capacity].group != group) { continue; }
+        *task = deque->tasks[(deque->head + position) % deque->capacity];
+        for (uint j = position + 1; j < deque->count; j++) {
+            deque->tasks[(deque->head + j - 1) % deque->capacity] = deque->tasks[(deque->head + j) % deque->capacity];
+        }
+        deque->count--;
+        didTakeTask(task);
+        didTake = 1;
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return didTake;
+}
+
+#pragma mark Running Tasks
+
+static uint currentDeque(void)
+{
+    uintptr_t worker = (uintptr_t)pthread_getspecific(scheduler.workerKey);
+    return worker == 0 ? scheduler.workerCount : (uint)(worker - 1);
+}
+
+// Background tasks are only taken once every other deque is empty.
+static int findTask(uint self, MCTask *task)
+{
+    int didFind = popTask(&scheduler.deques[self], task);
+    for (uint i = 1; !didFind && i <= scheduler.workerCount; i++) {
+        didFind = stealTask(&scheduler.deques[(self + i) % (scheduler.workerCount + 1)], task);
+    }
+    return didFind || stealTask(&scheduler.background, task);
+}
+
+// As findTask, but only for tasks of group. A thread waiting for a group stays out of unrelated work, which could
+// keep it busy long after its own group has finished.
+static int findGroupTask(uint self, MCTaskGroup *group, MCTask *task)
+{
+    int didFind = takeGroupTask(&scheduler.deques[self], group, 1, task);
+    for (uint i = 1; !didFind && i <= scheduler.workerCount; i++) {
+        didFind = takeGroupTask(&scheduler.deques[(self + i) % (scheduler.workerCount + 1)], group, 0, task);
+    }
+    return didFind || takeGroupTask(&scheduler.background, group, 1, task);
+}
+
+// The thread spawns background tasks while it runs one, whatever it was doing before.
+static void runTask(MCTask *task)
+{
+    MCTaskGroup *group = task->group;
+    void *wasBackground = pthread_getspecific(scheduler.backgroundKey);
+    pthread_setspecific(scheduler.backgroundKey, task->isBackground ? &scheduler.background : NULL);
+    task->function(task->argument);
+    pthread_setspecific(scheduler.backgroundKey, wasBackground);
+    if (atomic_fetch_sub(&group->pendingTasks, 1) == 1) {
+        pthread_mutex_lock(&scheduler.sleepLock);
+        pthread_cond_broadcast(&scheduler.wakeUp);
+        pthread_mutex_unlock(&scheduler.sleepLock);
+    }
+}
+
+static void *workerMain(void *argument)
+{
+    uint self = (uint)(uintptr_t)argument;
+    pthread_setspecific(scheduler.workerKey, (void *)(uintptr_t)(self + 1));
+    for (;;) {
+        MCTask task;
+        if (findTask(self, &task)) {
+            runTask(&task);
+            continue;
+        }
+        pthread_mutex_lock(&scheduler.sleepLock);
+        atomic_fetch_add(&scheduler.idleThreads, 1);
+        while (atomic_load(&scheduler.queuedTasks) == 0) {
+            pthread_cond_wait(&scheduler.wakeUp, &scheduler.sleepLock);
+        }
+        atomic_fetch_sub(&scheduler.idleThreads, 1);
+        pthread_mutex_unlock(&scheduler.sleepLock);
+    }
+    return NULL;
+}
+
+static void startScheduler(void)
+{
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    scheduler.workerCount = cores > 0 ? (uint)cores : 1;
+    scheduler.deques = malloc(sizeof(MCTaskDeque) * (scheduler.workerCount + 1));
+    for (uint i = 0; i <= scheduler.workerCount; i++) { initDeque(&scheduler.deques[i]); }
+    initDeque(&scheduler.background);
+    pthread_key_create(&scheduler.workerKey, NULL);
+    pthread_key_create(&scheduler.backgroundKey, NULL);
+    pthread_mutex_init(&scheduler.sleepLock, NULL);
+    pthread_cond_init(&scheduler.wakeUp, NULL);
+    atomic_init(&scheduler.queuedTasks, 0);
+    atomic_init(&scheduler.idleThreads, 0);
+
+    pthread_attr_t attributes;
+    pthread_attr_init(&attributes);
+    pthread_attr_setdetachstate(&attributes, PTHREAD_CREATE_DETACHED);
+    for (uint i = 0; i < scheduler.workerCount; i++) {
+        pthread_t thread;
+        pthread_create(&thread, &attributes, workerMain, (void *)(uintptr_t)i);
+    }
+    pthread_attr_destroy(&attributes);
+}
+
+#pragma mark Public Functions
+
+void initTaskGroup(MCTaskGroup *group)
+{
+    atomic_init(&group->pendingTasks, 0);
+    atomic_init(&group->queuedTasks, 0);
+}
+
+void spawnTask(MCTaskGroup *group, MCTaskFunction function, void *argument)
+{
+    pthread_once(&schedulerOnce, startScheduler);
+    MCTask task = { function, argument, group, threadSpawnsBackgroundTasks() };
+    atomic_fetch_add(&group->pendingTasks, 1);
+    pushTask(task.isBackground ? &scheduler.background : &scheduler.deques[currentDeque()], task);
+    // Every sleeper is woken, since the one waiting for this group might not be the one a signal would reach.
+    if (atomic_load(&scheduler.idleThreads) > 0) {
+        pthread_mutex_lock(&scheduler.sleepLock);
+        pthread_cond_broadcast(&scheduler.wakeUp);
+        pthread_mutex_unlock(&scheduler.sleepLock);
+    }
+}
+
+void waitForTaskGroup(MCTaskGroup *group)
+{
+    pthread_once(&schedulerOnce, startScheduler);
+    uint self = currentDeque();
+    while (atomic_load(&group->pendingTasks) > 0) {
+        MCTask task;
+        if (findGroupTask(self, group, &task)) {
+            runTask(&task);
+            continue;
+        }
+        // Everything left in the group is running on other threads.
+        pthread_mutex_lock(&scheduler.sleepLock);
+        atomic_fetch_add(&scheduler.idleThreads, 1);
+        while (atomic_load(&group->pendingTasks) > 0 && atomic_load(&group->queuedTasks) == 0) {
+            pthread_cond_wait(&scheduler.wakeUp, &scheduler.sleepLock);
+        }
+        atomic_fetch_sub(&scheduler.idleThreads, 1);
+        pthread_mutex_unlock(&scheduler.sleepLock);
+    }
+}
+
+void setThreadSpawnsBackgroundTasks(int isBackground)
+{
+    pthread_once(&schedulerOnce, startScheduler);
+    pthread_setspecific(scheduler.backgroundKey, isBackground ? &scheduler.background : NULL);
+}
+
+int threadSpawnsBackgroundTasks(void)
+{
+    pthread_once(&schedulerOnce, startScheduler);
+    return pthread_getspecific(scheduler.backgroundKey) != NULL;
+}
+
+uint idleWorkerCount(void)
+{
+    return atomic_load_explicit(&scheduler.idleThreads, memory_order_relaxed);
+}
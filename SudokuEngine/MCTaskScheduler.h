@@ -0,0 +1,48 @@
+//
+//  MCTaskScheduler.h
+//  Sudoku++
+//
+//  Created by Maarut Chandegra on 17/10/2026.
+//  Copyright © 2026 Maarut Chandegra. All rights reserved.
+//
+
+#ifndef MCTaskScheduler_h
+#define MCTaskScheduler_h
+
+#include <stdatomic.h>
+#include <sys/types.h>
+
+// A fixed pool of worker threads, one per core, each with its own deque of tasks. Workers take their newest task
+// first and steal the oldest task from another worker when they run out, so work spawned near the root of a search
+// is spread across the pool while deeper work stays on the thread that created it.
+//
+// Background tasks, such as puzzles generated ahead of time, go on a queue of their own that workers only take from
+// when no other task is queued. A background task that has started runs to the end, so other work waits for at most
+// the task each worker is in the middle of. The threads themselves all run at the same priority.
+
+typedef void (*MCTaskFunction)(void *argument);
+
+typedef struct _MCTaskGroup {
+    atomic_uint pendingTasks;       // Tasks spawned that haven't finished.
+    atomic_uint queuedTasks;        // Tasks spawned that no thread has started.
+} MCTaskGroup;
+
+void initTaskGroup(MCTaskGroup *group);
+
+// Queues function(argument) as part of group. Tasks spawned from a worker go on that worker's deque, tasks spawned
+// from any other thread go on a deque shared by all of them, and background tasks go on the background queue.
+void spawnTask(MCTaskGroup *group, MCTaskFunction function, void *argument);
+
+// Runs the group's queued tasks on the calling thread until every task in group has finished, so waiting from inside a
+// task never ties up a worker. Tasks of other groups are left to the workers.
+void waitForTaskGroup(MCTaskGroup *group);
+
+// Makes the tasks the calling thread spawns from now on background tasks, or not. Tasks spawned by a background task
+// are background tasks too, whichever thread runs it.
+void setThreadSpawnsBackgroundTasks(int isBackground);
+int threadSpawnsBackgroundTasks(void);
+
+// The number of threads currently waiting for work. Searches use this to decide whether splitting is worthwhile.
+uint idleWorkerCount(void);
+
+#endif /* MCTaskScheduler_h */
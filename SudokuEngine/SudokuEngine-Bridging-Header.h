@@ -3,3 +3,5 @@
 //
 
 #import "MCSudokuEngine.h"
+#import "MCPuzzleBank.h"
+#import "MCPuzzlePool.h"
@@ -0,0 +1,529 @@
+//
+//  MCSudokuEngineTests.m
+//  SudokuEngineTests
+//
+//  Created by Maarut Chandegra on 17/10/2026.
+//  Copyright © 2026 Maarut Chandegra. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "../SudokuEngine/MCCanonicalForm.h"
+#include "../SudokuEngine/MCPencilMarkKernels.h"
+#include "../SudokuEngine/MCRandom.h"
+#include "../SudokuEngine/MCSolutionGrid.h"
+#include "../SudokuEngine/MCTaskScheduler.h"
+
+// Tests of the engine's C internals, which the Swift tests can't reach.
+
+@interface MCSudokuEngineTests : XCTestCase
+@end
+
+#pragma mark Task Scheduler
+
+#define MCInnerTaskCount 16
+#define MCOuterTaskCount 16
+#define MCConcurrentGroupCount 8
+#define MCBackgroundTaskCount 64
+#define MCKernelWordCount 70
+#define MC4x4GridCount 288
+#define MCGridMaxOrder 6            // One past the largest order filled cell by cell, so shuffled grids are tested too.
+
+// Records whether a task ran on the thread waiting for another group.
+typedef struct _MCWaiterTask {
+    pthread_t waiter;
+    atomic_int didRunOnWaiter;
+} MCWaiterTask;
+
+static void countTask(void *argument)
+{
+    atomic_fetch_add((atomic_uint *)argument, 1);
+}
+
+// Keeps the workers busy long enough for the waiter to find the other group's tasks queued.
+static void countTaskSlowly(void *argument)
+{
+    usleep(1000);
+    countTask(argument);
+}
+
+static void spawnInnerTasks(void *argument)
+{
+    MCTaskGroup group;
+    initTaskGroup(&group);
+    for (uint i = 0; i < MCInnerTaskCount; i++) { spawnTask(&group, countTask, argument); }
+    waitForTaskGroup(&group);
+}
+
+static void *runConcurrentGroup(void *argument)
+{
+    MCTaskGroup group;
+    initTaskGroup(&group);
+    for (uint i = 0; i < MCOuterTaskCount; i++) { spawnTask(&group, spawnInnerTasks, argument); }
+    waitForTaskGroup(&group);
+    return NULL;
+}
+
+static void recordWaiter(void *argument)
+{
+    MCWaiterTask *task = argument;
+    if (pthread_equal(pthread_self(), task->waiter)) { atomic_store(&task->didRunOnWaiter, 1); }
+}
+
+// Records how far the background tasks had got whenever a foreground task started.
+typedef struct _MCLaneTasks {
+    atomic_uint backgroundStarted;
+    atomic_uint mostBackgroundStarted;
+    atomic_int didMixLanes;         // A task spawned background tasks when it shouldn't have, or the other way round.
+} MCLaneTasks;
+
+static void checkBackgroundTask(void *argument)
+{
+    MCLaneTasks *tasks = argument;
+    if (!threadSpawnsBackgroundTasks()) { atomic_store(&tasks->didMixLanes, 1); }
+}
+
+static void runBackgroundTask(void *argument)
+{
+    MCLaneTasks *tasks = argument;
+    atomic_fetch_add(&tasks->backgroundStarted, 1);
+    MCTaskGroup group;
+    initTaskGroup(&group);
+    spawnTask(&group, checkBackgroundTask, tasks);
+    waitForTaskGroup(&group);
+    usleep(5000);
+}
+
+static void runForegroundTask(void *argument)
+{
+    MCLaneTasks *tasks = argument;
+    if (threadSpawnsBackgroundTasks()) { atomic_store(&tasks->didMixLanes, 1); }
+    uint started = atomic_load(&tasks->backgroundStarted), most = atomic_load(&tasks->mostBackgroundStarted);
+    while (started > most && !atomic_compare_exchange_weak(&tasks->mostBackgroundStarted, &most, started)) { }
+    usleep(1000);
+}
+
+#pragma mark Grids
+
+// Whether every row, column and box of grid holds each number once.
+static int isValidGrid(uint order, const uint *grid)
+{
+    uint dimensionality = order * order;
+    for (uint unit = 0; unit < dimensionality; unit++) {
+        uint64_t rowNumbers = 0, columnNumbers = 0, boxNumbers = 0;
+        for (uint i = 0; i < dimensionality; i++) {
+            uint boxRow = unit / order * order + i / order, boxColumn = unit % order * order + i % order;
+            rowNumbers |= 1ull << grid[unit * dimensionality + i];
+            columnNumbers |= 1ull << grid[i * dimensionality + unit];
+            boxNumbers |= 1ull << grid[boxRow * dimensionality + boxColumn];
+        }
+        uint64_t allNumbers = ((1ull << dimensionality) - 1) << 1;
+        if (rowNumbers != allNumbers || columnNumbers != allNumbers || boxNumbers != allNumbers) { return 0; }
+    }
+    return 1;
+}
+
+// Puts the same number twice in the first row of an otherwise empty puzzle.
+static MCSudokuSolveContext *createInvalidPuzzle(uint order)
+{
+    MCSudokuSolveContext *context = createContext(order);
+    context->problem[0] = 1;
+    context->problem[1] = 1;
+    return context;
+}
+
+#pragma mark Enumeration
+
+typedef struct _MCEnumeratedGrids {
+    uint order;
+    uint count;
+    uint stopAfter;             // The number of grids after which the callback returns 0, or 0 to never stop.
+    uint invalidCount;
+    int isSlow;                 // Sleeps in each call, giving the other branches time to find solutions of their own.
+    uint grids[MC4x4GridCount][16];
+} MCEnumeratedGrids;
+
+static int collectGrid(const uint *solution, void *info)
+{
+    MCEnumeratedGrids *grids = info;
+    if (!isValidGrid(grids->order, solution)) { grids->invalidCount++; }
+    if (grids->count < MC4x4GridCount) { memcpy(grids->grids[grids->count], solution, sizeof(grids->grids[0])); }
+    grids->count++;
+    if (grids->isSlow) { usleep(1000); }
+    return grids->stopAfter == 0 || grids->count < grids->stopAfter;
+}
+
+#pragma mark Requests
+
+typedef struct _MCCompletionRecord {
+    pthread_mutex_t lock;
+    pthread_cond_t condition;
+    MCSudokuSolveContext *context;      // Set by the completion.
+} MCCompletionRecord;
+
+static void initCompletionRecord(MCCompletionRecord *record)
+{
+    pthread_mutex_init(&record->lock, NULL);
+    pthread_cond_init(&record->condition, NULL);
+    record->context = NULL;
+}
+
+static void destroyCompletionRecord(MCCompletionRecord *record)
+{
+    pthread_cond_destroy(&record->condition);
+    pthread_mutex_destroy(&record->lock);
+}
+
+static void recordCompletion(MCSudokuSolveContext *context, void *info)
+{
+    MCCompletionRecord *record = info;
+    pthread_mutex_lock(&record->lock);
+    record->context = context;
+    pthread_cond_signal(&record->condition);
+    pthread_mutex_unlock(&record->lock);
+}
+
+static MCSudokuSolveContext *waitForCompletion(MCCompletionRecord *record)
+{
+    pthread_mutex_lock(&record->lock);
+    while (record->context == NULL) { pthread_cond_wait(&record->condition, &record->lock); }
+    pthread_mutex_unlock(&record->lock);
+    return record->context;
+}
+
+@implementation MCSudokuEngineTests
+
+- (void)testNestedTaskGroups
+{
+    atomic_uint count;
+    atomic_init(&count, 0);
+    runConcurrentGroup(&count);
+    XCTAssertEqual(atomic_load(&count), MCOuterTaskCount * MCInnerTaskCount);
+}
+
+- (void)testConcurrentTaskGroups
+{
+    pthread_t threads[MCConcurrentGroupCount];
+    atomic_uint counts[MCConcurrentGroupCount];
+    for (uint i = 0; i < MCConcurrentGroupCount; i++) {
+        atomic_init(&counts[i], 0);
+        XCTAssertEqual(pthread_create(&threads[i], NULL, runConcurrentGroup, &counts[i]), 0);
+    }
+    for (uint i = 0; i < MCConcurrentGroupCount; i++) {
+        pthread_join(threads[i], NULL);
+        XCTAssertEqual(atomic_load(&counts[i]), MCOuterTaskCount * MCInnerTaskCount);
+    }
+}
+
+- (void)testWaitingLeavesOtherGroupsToWorkers
+{
+    MCTaskGroup unrelated, group;
+    initTaskGroup(&unrelated);
+    initTaskGroup(&group);
+    MCWaiterTask task = { .waiter = pthread_self() };
+    atomic_init(&task.didRunOnWaiter, 0);
+    atomic_uint count;
+    atomic_init(&count, 0);
+    for (uint i = 0; i < MCInnerTaskCount; i++) { spawnTask(&group, countTaskSlowly, &count); }
+    for (uint i = 0; i < MCInnerTaskCount; i++) { spawnTask(&unrelated, recordWaiter, &task); }
+    waitForTaskGroup(&group);
+    XCTAssertEqual(atomic_load(&count), MCInnerTaskCount);
+    XCTAssertFalse(atomic_load(&task.didRunOnWaiter));
+    waitForTaskGroup(&unrelated);
+}
+
+// Each worker can have started one background task before the others are spawned, but no more until they're done.
+- (void)testBackgroundTasksWaitForOthers
+{
+    uint workerCount = (uint)sysconf(_SC_NPROCESSORS_ONLN);
+    MCLaneTasks tasks;
+    atomic_init(&tasks.backgroundStarted, 0);
+    atomic_init(&tasks.mostBackgroundStarted, 0);
+    atomic_init(&tasks.didMixLanes, 0);
+    MCTaskGroup background, foreground;
+    initTaskGroup(&background);
+    initTaskGroup(&foreground);
+    setThreadSpawnsBackgroundTasks(1);
+    for (uint i = 0; i < MCBackgroundTaskCount; i++) { spawnTask(&background, runBackgroundTask, &tasks); }
+    setThreadSpawnsBackgroundTasks(0);
+    for (uint i = 0; i < MCInnerTaskCount; i++) { spawnTask(&foreground, runForegroundTask, &tasks); }
+    waitForTaskGroup(&foreground);
+    XCTAssertLessThanOrEqual(atomic_load(&tasks.mostBackgroundStarted), workerCount);
+    waitForTaskGroup(&background);
+    XCTAssertEqual(atomic_load(&tasks.backgroundStarted), MCBackgroundTaskCount);
+    XCTAssertFalse(atomic_load(&tasks.didMixLanes));
+}
+
+#pragma mark Counting Solutions
+
+- (void)testCountSolutionsStopsAtLimit
+{
+    MCSudokuSolveContext *context = createContext(3);
+    XCTAssertEqual(countSolutions(context, 5), 5);
+    XCTAssertEqual(context->solutionCount, 5);
+    XCTAssertEqual(context->status, MCSolveStatusMultipleSolutions);
+    XCTAssertTrue(isValidGrid(3, context->solution));
+    destroyContext(context);
+}
+
+- (void)testCountSolutionsOfInvalidPuzzle
+{
+    MCSudokuSolveContext *context = createInvalidPuzzle(3);
+    XCTAssertEqual(countSolutions(context, 2), 0);
+    XCTAssertEqual(context->solutionCount, 0);
+    XCTAssertEqual(context->status, MCSolveStatusNoSolution);
+    destroyContext(context);
+}
+
+- (void)testCountSolutionsLeavesDifficultyAlone
+{
+    MCSudokuSolveContext *puzzle = generatePuzzleWithOrder(3, MCPuzzleDifficultyHard, 42);
+    MCSudokuSolveContext *context = createContext(3);
+    memcpy(context->problem, puzzle->problem, sizeof(uint) * puzzle->cellCount);
+    context->difficultyScore = 1234;
+    context->difficulty = MCPuzzleDifficultyInsane;
+    XCTAssertEqual(countSolutions(context, 2), 1);
+    XCTAssertEqual(context->difficultyScore, 1234);
+    XCTAssertEqual(context->difficulty, MCPuzzleDifficultyInsane);
+    XCTAssertEqual(memcmp(context->solution, puzzle->solution, sizeof(uint) * puzzle->cellCount), 0);
+    destroyContext(context);
+    destroyContext(puzzle);
+}
+
+#pragma mark Enumerating Solutions
+
+- (void)testEnumerateEvery4x4Grid
+{
+    MCEnumeratedGrids *grids = calloc(1, sizeof(MCEnumeratedGrids));
+    grids->order = 2;
+    MCSudokuSolveContext *context = createContext(2);
+    XCTAssertEqual(enumerateSolutions(context, UINT_MAX, collectGrid, grids), MC4x4GridCount);
+    XCTAssertEqual(grids->count, MC4x4GridCount);
+    XCTAssertEqual(grids->invalidCount, 0);
+    uint duplicateCount = 0;
+    for (uint i = 0; i < MC4x4GridCount; i++) {
+        for (uint j = i + 1; j < MC4x4GridCount; j++) {
+            if (memcmp(grids->grids[i], grids->grids[j], sizeof(grids->grids[0])) == 0) { duplicateCount++; }
+        }
+    }
+    XCTAssertEqual(duplicateCount, 0);
+    destroyContext(context);
+    free(grids);
+}
+
+// The branches of the 9x9 search that are still running when the callback says stop go on finding solutions.
+- (void)testEnumerateStopsWhenCallbackReturnsZero
+{
+    for (uint order = 2; order <= 3; order++) {
+        MCEnumeratedGrids *grids = calloc(1, sizeof(MCEnumeratedGrids));
+        grids->order = order;
+        grids->stopAfter = 3;
+        grids->isSlow = order == 3;
+        MCSudokuSolveContext *context = createContext(order);
+        XCTAssertEqual(enumerateSolutions(context, UINT_MAX, collectGrid, grids), 3, @"order %u", order);
+        XCTAssertEqual(grids->count, 3, @"order %u", order);
+        XCTAssertEqual(grids->invalidCount, 0, @"order %u", order);
+        destroyContext(context);
+        free(grids);
+    }
+}
+
+- (void)testEnumerateSolutionsOfInvalidPuzzle
+{
+    MCEnumeratedGrids *grids = calloc(1, sizeof(MCEnumeratedGrids));
+    grids->order = 2;
+    MCSudokuSolveContext *context = createInvalidPuzzle(2);
+    XCTAssertEqual(enumerateSolutions(context, UINT_MAX, collectGrid, grids), 0);
+    XCTAssertEqual(grids->count, 0);
+    XCTAssertEqual(context->status, MCSolveStatusNoSolution);
+    destroyContext(context);
+    free(grids);
+}
+
+#pragma mark Budgets and Requests
+
+- (void)testSolveOverBudget
+{
+    MCSudokuSolveContext *context = createContext(3);
+    context->budget.guessLimit = 1;
+    XCTAssertFalse(solveContext(context));
+    XCTAssertEqual(context->status, MCSolveStatusOverBudget);
+    context->budget = (MCSolveBudget){ 0.05, 0 };
+    countSolutions(context, UINT_MAX);
+    XCTAssertEqual(context->status, MCSolveStatusOverBudget);
+    context->budget = (MCSolveBudget){ 0, 0 };
+    XCTAssertFalse(solveContext(context));
+    XCTAssertEqual(context->status, MCSolveStatusMultipleSolutions);
+    destroyContext(context);
+}
+
+- (void)testSolveRequestCallsCompletion
+{
+    MCSudokuSolveContext *puzzle = generatePuzzleWithOrder(3, MCPuzzleDifficultyHard, 42);
+    MCSudokuSolveContext *context = createContext(3);
+    memcpy(context->problem, puzzle->problem, sizeof(uint) * puzzle->cellCount);
+    MCCompletionRecord record;
+    initCompletionRecord(&record);
+    MCSolveRequest *request = solveContextAsync(context, recordCompletion, &record);
+    XCTAssertTrue(request != NULL);
+    XCTAssertEqual(waitForCompletion(&record), context);
+    XCTAssertEqual(context->status, MCSolveStatusSolved);
+    XCTAssertEqual(context->difficultyScore, puzzle->difficultyScore);
+    releaseSolveRequest(request);
+    destroyCompletionRecord(&record);
+    destroyContext(context);
+    destroyContext(puzzle);
+}
+
+// An empty 25x25 takes long enough to grade that the cancel always comes first.
+- (void)testCancelSolveRequest
+{
+    MCSudokuSolveContext *context = createContext(5);
+    MCCompletionRecord record;
+    initCompletionRecord(&record);
+    MCSolveRequest *request = solveContextAsync(context, recordCompletion, &record);
+    XCTAssertTrue(request != NULL);
+    cancelSolveRequest(request);
+    XCTAssertEqual(waitForCompletion(&record), context);
+    XCTAssertEqual(context->status, MCSolveStatusCancelled);
+    cancelSolveRequest(request);
+    releaseSolveRequest(request);
+    destroyCompletionRecord(&record);
+    destroyContext(context);
+}
+
+#pragma mark Solution Grids
+
+- (void)testFillSolutionGrid
+{
+    for (uint order = 2; order <= MCGridMaxOrder; order++) {
+        MCSudokuSolveContext *context = createContext(order);
+        uint *grid = malloc(sizeof(uint) * context->cellCount);
+        for (uint64_t seed = 1; seed <= 8; seed++) {
+            MCRandomState random;
+            seedRandom(&random, seed);
+            fillSolutionGrid(context, &random, grid);
+            XCTAssertTrue(isValidGrid(order, grid), @"order %u, seed %llu", order, seed);
+        }
+        free(grid);
+        destroyContext(context);
+    }
+}
+
+- (void)testFillSolutionGridWithSeedIsRepeatable
+{
+    for (uint order = 2; order <= MCGridMaxOrder; order++) {
+        MCSudokuSolveContext *context = createContext(order);
+        size_t gridSize = sizeof(uint) * context->cellCount;
+        uint *grid = malloc(gridSize), *repeated = malloc(gridSize), *other = malloc(gridSize);
+        MCRandomState random, repeatedRandom, otherRandom;
+        seedRandom(&random, 42);
+        seedRandom(&repeatedRandom, 42);
+        seedRandom(&otherRandom, 7);
+        fillSolutionGrid(context, &random, grid);
+        fillSolutionGrid(context, &repeatedRandom, repeated);
+        fillSolutionGrid(context, &otherRandom, other);
+        XCTAssertEqual(memcmp(grid, repeated, gridSize), 0, @"order %u", order);
+        XCTAssertNotEqual(memcmp(grid, other, gridSize), 0, @"order %u", order);
+        free(grid);
+        free(repeated);
+        free(other);
+        destroyContext(context);
+    }
+}
+
+#pragma mark Canonical Forms
+
+- (void)testCanonicalFormIgnoresSymmetries
+{
+    for (uint order = 2; order <= 3; order++) {
+        MCSudokuSolveContext *puzzle = generatePuzzleWithOrder(order, MCPuzzleDifficultyNormal, order);
+        size_t gridSize = sizeof(uint) * puzzle->cellCount;
+        uint *canonical = malloc(gridSize), *transformed = malloc(gridSize), *other = malloc(gridSize);
+        MCSudokuTransform *transform = createTransform(order);
+        XCTAssertEqual(canonicalizeGrid(order, puzzle->problem, canonical, transform), 1, @"order %u", order);
+        applyTransform(transform, puzzle->problem, transformed);
+        XCTAssertEqual(memcmp(transformed, canonical, gridSize), 0, @"order %u", order);
+
+        MCRandomState random;
+        seedRandom(&random, order);
+        for (uint i = 0; i < 8; i++) {
+            randomizeTransform(transform, &random);
+            applyTransform(transform, puzzle->problem, transformed);
+            XCTAssertEqual(canonicalizeGrid(order, transformed, other, NULL), 1, @"order %u, transform %u", order, i);
+            XCTAssertEqual(memcmp(other, canonical, gridSize), 0, @"order %u, transform %u", order, i);
+        }
+        destroyTransform(transform);
+        free(canonical);
+        free(transformed);
+        free(other);
+        destroyContext(puzzle);
+    }
+}
+
+- (void)testCanonicalizeEmptyGridGivesUp
+{
+    MCSudokuSolveContext *context = createContext(3);
+    uint *canonical = malloc(sizeof(uint) * context->cellCount);
+    XCTAssertEqual(canonicalizeGrid(3, context->problem, canonical, NULL), 0);
+    free(canonical);
+    destroyContext(context);
+}
+
+- (void)testPuzzleSetLeavesOutSymmetries
+{
+    MCSudokuSolveContext *puzzle = generatePuzzleWithOrder(3, MCPuzzleDifficultyNormal, 1);
+    MCSudokuSolveContext *isomorph = createIsomorphicPuzzle(puzzle, 2);
+    MCSudokuSolveContext *other = generatePuzzleWithOrder(3, MCPuzzleDifficultyNormal, 3);
+    MCSudokuSolveContext *empty = createContext(3);
+    MCPuzzleSet *set = createPuzzleSet(3);
+    XCTAssertNotEqual(memcmp(puzzle->problem, isomorph->problem, sizeof(uint) * puzzle->cellCount), 0);
+    XCTAssertEqual(addPuzzleToSet(set, puzzle->problem), 1);
+    XCTAssertEqual(addPuzzleToSet(set, isomorph->problem), 0);
+    XCTAssertEqual(addPuzzleToSet(set, puzzle->problem), 0);
+    XCTAssertEqual(addPuzzleToSet(set, other->problem), 1);
+    XCTAssertEqual(addPuzzleToSet(set, empty->problem), -1);
+    XCTAssertEqual(puzzleSetCount(set), 2);
+    destroyPuzzleSet(set);
+    destroyContext(puzzle);
+    destroyContext(isomorph);
+    destroyContext(other);
+    destroyContext(empty);
+}
+
+#pragma mark Pencil Mark Kernels
+
+// Runs of every length up to a few vectors, so each kernel's scalar tail is tested as well as its vector loop.
+- (void)testPencilMarkKernelsAgreeWithScalar
+{
+    uint kernelCount;
+    const MCPencilMarkKernels *kernels = availablePencilMarkKernels(&kernelCount);
+    XCTAssertGreaterThanOrEqual(kernelCount, 1);
+    XCTAssertEqual(pencilMarkKernels(), &kernels[kernelCount - 1]);
+    MCRandomState random;
+    seedRandom(&random, 42);
+    MCPencilMarkWord words[MCKernelWordCount];
+    for (uint count = 0; count <= MCKernelWordCount; count++) {
+        // Sparse words as well as dense ones, so marks are often seen exactly once.
+        for (uint i = 0; i < count; i++) { words[i] = nextRandom(&random) & nextRandom(&random) & nextRandom(&random); }
+        MCPencilMarkWord seen, seenTwice;
+        uint8_t counts[MCKernelWordCount];
+        kernels[0].reduce(words, count, &seen, &seenTwice);
+        kernels[0].count(words, count, counts);
+        for (uint k = 1; k < kernelCount; k++) {
+            MCPencilMarkWord kernelSeen = ~0ull, kernelSeenTwice = ~0ull;
+            uint8_t kernelCounts[MCKernelWordCount];
+            kernels[k].reduce(words, count, &kernelSeen, &kernelSeenTwice);
+            kernels[k].count(words, count, kernelCounts);
+            XCTAssertEqual(kernelSeen, seen, @"%s", kernels[k].name);
+            XCTAssertEqual(kernelSeenTwice, seenTwice, @"%s", kernels[k].name);
+            XCTAssertEqual(memcmp(kernelCounts, counts, count), 0, @"%s", kernels[k].name);
+        }
+    }
+}
+
+@end
@@ -39,6 +39,25 @@ class SudokuEngineTests: XCTestCase
         }
     }
     
+    func testGenerateWithSeedIsRepeatable()
+    {
+        let board = SudokuBoard.generatePuzzle(ofOrder: 3, difficulty: .hard, seed: 42)!
+        let repeated = SudokuBoard.generatePuzzle(ofOrder: 3, difficulty: .hard, seed: 42)!
+        XCTAssertEqual(board.description, repeated.description)
+        XCTAssertEqual(board.solutionDescription, repeated.solutionDescription)
+        XCTAssertEqual(board.difficultyScore, repeated.difficultyScore)
+    }
+    
+    func testGeneratedPuzzleRegradesToItsScore()
+    {
+        for difficulty in [PuzzleDifficulty.easy, .normal, .hard, .insane] {
+            let board = SudokuBoard.generatePuzzle(ofOrder: 3, difficulty: difficulty, seed: 42)!
+            let difficultyScore = board.difficultyScore
+            XCTAssertTrue(board.solve())
+            XCTAssertEqual(board.difficultyScore, difficultyScore)
+        }
+    }
+    
     func testGenerateFailure()
     {
         let board = SudokuBoard.generatePuzzle(ofOrder: 0, difficulty: .easy)
@@ -77,6 +96,141 @@ class SudokuEngineTests: XCTestCase
         }
     }
     
+    func testSolveRepeatedly()
+    {
+        let board = SudokuBoard.generatePuzzle(ofOrder: 3, difficulty: .blank)!
+        for (i, number) in puzzle.enumerated() where number != 0 {
+            let row = i / board.dimensionality
+            let column = i % board.dimensionality
+            board.cellAt(SudokuBoardIndex(row: row, column: column))!.number = number
+        }
+        XCTAssertTrue(board.solve())
+        let solution = board.solutionDescription
+        let difficulty = board.difficulty
+        XCTAssertTrue(board.solve())
+        XCTAssertEqual(solution, board.solutionDescription)
+        XCTAssertEqual(difficulty, board.difficulty)
+    }
+    
+    func testSolveOverBudget()
+    {
+        let board = SudokuBoard.generatePuzzle(ofOrder: 3, difficulty: .blank)!
+        for (i, number) in puzzle.enumerated() where number != 0 {
+            let row = i / board.dimensionality
+            let column = i % board.dimensionality
+            board.cellAt(SudokuBoardIndex(row: row, column: column))!.number = number
+        }
+        board.solveBudget = SolveBudget(seconds: 0, guessLimit: 1)
+        XCTAssertFalse(board.solve())
+        XCTAssertEqual(board.solveStatus, .overBudget)
+        XCTAssertEqual(board.difficulty, .blank)
+        board.solveBudget = .unlimited
+        XCTAssertTrue(board.solve())
+        XCTAssertEqual(board.solveStatus, .solved)
+    }
+    
+    func testSolveAsynchronously()
+    {
+        let generated = SudokuBoard.generatePuzzle(ofOrder: 3, difficulty: .hard, seed: 42)!
+        let board = SudokuBoard.generatePuzzle(ofOrder: 3, difficulty: .blank)!
+        for row in 0 ..< board.dimensionality {
+            for column in 0 ..< board.dimensionality {
+                let index = SudokuBoardIndex(row: row, column: column)
+                board.cellAt(index)!.number = generated.cellAt(index)!.number
+            }
+        }
+        let solved = expectation(description: "Solve completed")
+        let request = board.solve { isSolved in
+            XCTAssertTrue(Thread.isMainThread)
+            XCTAssertTrue(isSolved)
+            XCTAssertEqual(board.solveStatus, .solved)
+            XCTAssertEqual(board.solutionDescription, generated.solutionDescription)
+            XCTAssertEqual(board.difficultyScore, generated.difficultyScore)
+            solved.fulfill()
+        }
+        XCTAssertNotNil(request)
+        waitForExpectations(timeout: 10)
+    }
+    
+    // An empty 25x25 takes long enough to grade that the cancel always comes first.
+    func testCancelSolve()
+    {
+        let board = SudokuBoard.generatePuzzle(ofOrder: 5, difficulty: .blank)!
+        let cancelled = expectation(description: "Solve completed")
+        let request = board.solve { isSolved in
+            XCTAssertFalse(isSolved)
+            XCTAssertEqual(board.solveStatus, .cancelled)
+            XCTAssertEqual(board.difficulty, .blank)
+            cancelled.fulfill()
+        }
+        XCTAssertNotNil(request)
+        request?.cancel()
+        waitForExpectations(timeout: 10)
+    }
+    
+    func testSolveWithoutGuessesDoesNotAllocate()
+    {
+        let board = SudokuBoard.generatePuzzle(ofOrder: 3, difficulty: .easy, seed: 7)!
+        XCTAssertTrue(board.solve())
+        XCTAssertEqual(board.solveAllocationCount, 0)
+    }
+    
+    func testHasUniqueSolution()
+    {
+        let board = SudokuBoard.generatePuzzle(ofOrder: 3, difficulty: .blank)!
+        for (i, number) in puzzle.enumerated() where number != 0 {
+            let row = i / board.dimensionality
+            let column = i % board.dimensionality
+            board.cellAt(SudokuBoardIndex(row: row, column: column))!.number = number
+        }
+        XCTAssertTrue(board.hasUniqueSolution())
+        board.cellAt(SudokuBoardIndex(row: 8, column: 8))?.number = nil
+        XCTAssertFalse(board.hasUniqueSolution())
+    }
+    
+    func testIsomorph()
+    {
+        let board = SudokuBoard.generatePuzzle(ofOrder: 3, difficulty: .hard, seed: 42)!
+        let isomorph = board.isomorph(seed: 7)!
+        XCTAssertNotEqual(board.description, isomorph.description)
+        XCTAssertEqual(board.difficulty, isomorph.difficulty)
+        XCTAssertEqual(board.difficultyScore, isomorph.difficultyScore)
+        XCTAssertTrue(isomorph.hasUniqueSolution())
+    }
+
+    func testPuzzleBankRejectsOtherFiles()
+    {
+        let url = URL(fileURLWithPath: NSTemporaryDirectory()).appendingPathComponent("NotABank.bank")
+        XCTAssertNil(PuzzleBank(contentsOf: url))
+        try! Data(repeating: 0, count: 64).write(to: url)
+        defer { try? FileManager.default.removeItem(at: url) }
+        XCTAssertNil(PuzzleBank(contentsOf: url))
+    }
+
+    func testPuzzlePool()
+    {
+        let pool = PuzzlePool(order: 3, capacity: 1)!
+        let board = pool.puzzle(difficulty: .hard)!
+        XCTAssertTrue(board.hasUniqueSolution())
+        XCTAssertEqual(pool.hitCount + pool.missCount, 1)
+        XCTAssertNil(pool.puzzle(difficulty: .blank))
+        
+        // Once every difficulty has a puzzle ready, taking one is a hit and the pool generates another in its place.
+        waitForRefills(of: pool, count: 4 + pool.hitCount)
+        let hitCount = pool.hitCount, missCount = pool.missCount, refillCount = pool.refillCount
+        XCTAssertTrue(pool.puzzle(difficulty: .hard)!.hasUniqueSolution())
+        XCTAssertEqual(pool.hitCount, hitCount + 1)
+        XCTAssertEqual(pool.missCount, missCount)
+        waitForRefills(of: pool, count: refillCount + 1)
+        XCTAssertGreaterThan(pool.averageRefillTime, 0)
+    }
+    
+    private func waitForRefills(of pool: PuzzlePool, count: Int)
+    {
+        let refilled = expectation(for: NSPredicate { _, _ in pool.refillCount >= count }, evaluatedWith: pool)
+        wait(for: [refilled], timeout: 60)
+    }
+
     func testSudokuBoardIsSolved()
     {
         let board = SudokuBoard.generatePuzzle(ofOrder: 3, difficulty: .easy)!
@@ -0,0 +1,174 @@
+//
+//  main.c
+//  Sudoku++
+//
+//  Created by Maarut Chandegra on 17/10/2026.
+//  Copyright © 2026 Maarut Chandegra. All rights reserved.
+//
+
+// Solves puzzles read one per line, either from the files named on the command line or from standard input, and
+// writes one line per puzzle in the same order:
+//
+//     <solution>\t<solution count>\t<difficulty score>
+//
+// Puzzles and solutions are in the format described in MCPuzzleFormat.h. The solution is '-' unless the puzzle has
+// exactly one, and the count stops at 2.
+
+#include "MCPuzzleFormat.h"
+#include "MCSudokuEngine.h"
+#include "MCTaskScheduler.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define MCBatchSize 65536
+#define MCChunkSize 64
+
+#pragma mark Typedefs
+
+typedef struct _MCPuzzleLine {
+    char *text;
+    size_t length;
+    unsigned long lineNumber;
+    uint solutionCount;
+    uint difficultyScore;
+    char *solution;     // NULL unless there's a unique solution.
+} MCPuzzleLine;
+
+typedef struct _MCChunk {
+    MCPuzzleLine *lines;
+    uint count;
+    int isExactCover;
+} MCChunk;
+
+#pragma mark Solving
+
+static void solveLine(MCPuzzleLine *line, MCSudokuSolveContext **contexts, int isExactCover)
+{
+    line->solutionCount = 0;
+    line->difficultyScore = 0;
+    line->solution = NULL;
+    uint order = orderForPuzzleLength(line->length);
+    if (order == 0) {
+        fprintf(stderr, "Line %lu: %zu characters isn't a puzzle\n", line->lineNumber, line->length);
+        return;
+    }
+    if (contexts[order] == NULL) { contexts[order] = createContext(order); }
+    MCSudokuSolveContext *context = contexts[order];
+    uint badIndex = readPuzzle(line->text, context->dimensionality, context->cellCount, context->problem);
+    if (badIndex < context->cellCount) {
+        fprintf(stderr, "Line %lu: unexpected '%c'\n", line->lineNumber, line->text[badIndex]);
+        return;
+    }
+
+    int isUnique = isExactCover ? solveContextExactCover(context) : solveContext(context);
+    line->solutionCount = context->solutionCount;
+    line->difficultyScore = isExactCover ? 0 : context->difficultyScore;
+    if (isUnique) {
+        line->solution = malloc(context->cellCount + 1);
+        writePuzzle(context->solution, context->cellCount, line->solution);
+    }
+}
+
+static void solveChunk(void *argument)
+{
+    MCChunk *chunk = argument;
+    MCSudokuSolveContext *contexts[MCPuzzleFormatMaxOrder + 1] = { NULL };
+    for (uint i = 0; i < chunk->count; i++) { solveLine(&chunk->lines[i], contexts, chunk->isExactCover); }
+    for (uint order = 0; order <= MCPuzzleFormatMaxOrder; order++) { destroyContext(contexts[order]); }
+}
+
+static void solveBatch(MCPuzzleLine *lines, uint count, int isExactCover)
+{
+    uint chunkCount = (count + MCChunkSize - 1) / MCChunkSize;
+    MCChunk *chunks = malloc(sizeof(MCChunk) * chunkCount);
+    MCTaskGroup group;
+    initTaskGroup(&group);
+    for (uint i = 0; i < chunkCount; i++) {
+        chunks[i].lines = lines + i * MCChunkSize;
+        chunks[i].count = i == chunkCount - 1 ? count - i * MCChunkSize : MCChunkSize;
+        chunks[i].isExactCover = isExactCover;
+        spawnTask(&group, solveChunk, &chunks[i]);
+    }
+    waitForTaskGroup(&group);
+    free(chunks);
+}
+
+static void writeBatch(MCPuzzleLine *lines, uint count, FILE *output)
+{
+    for (uint i = 0; i < count; i++) {
+        fprintf(output, "%s\t%u\t%u\n", lines[i].solution != NULL ? lines[i].solution : "-",
+            lines[i].solutionCount, lines[i].difficultyScore);
+        free(lines[i].solution);
+        free(lines[i].text);
+    }
+}
+
+// Blank lines and lines starting with '#' are skipped, but still count towards the line numbers in error messages.
+static void solveFile(FILE *input, FILE *output, int isExactCover)
+{
+    MCPuzzleLine *lines = malloc(sizeof(MCPuzzleLine) * MCBatchSize);
+    uint count = 0;
+    unsigned long lineNumber = 0;
+    char *text = NULL;
+    size_t capacity = 0;
+    ssize_t length;
+    while ((length = getline(&text, &capacity, input)) != -1) {
+        lineNumber++;
+        while (length > 0 && (text[length - 1] == '\n' || text[length - 1] == '\r')) { text[--length] = '\0'; }
+        if (length == 0 || text[0] == '#') { continue; }
+        lines[count].text = strdup(text);
+        lines[count].length = length;
+        lines[count].lineNumber = lineNumber;
+        if (++count == MCBatchSize) {
+            solveBatch(lines, count, isExactCover);
+            writeBatch(lines, count, output);
+            count = 0;
+        }
+    }
+    if (count > 0) {
+        solveBatch(lines, count, isExactCover);
+        writeBatch(lines, count, output);
+    }
+    free(text);
+    free(lines);
+}
+
+#pragma mark Main
+
+static void printUsage(const char *name)
+{
+    fprintf(stderr, "Usage: %s [-x] [file ...]\n", name);
+    fprintf(stderr, "  -x  Only check for a unique solution with the exact cover solver, without grading\n");
+}
+
+int main(int argc, char *argv[])
+{
+    int isExactCover = 0, option;
+    while ((option = getopt(argc, argv, "xh")) != -1) {
+        switch (option) {
+            case 'x':
+                isExactCover = 1;
+                break;
+            default:
+                printUsage(argv[0]);
+                return option == 'h' ? 0 : 1;
+        }
+    }
+
+    if (optind == argc) {
+        solveFile(stdin, stdout, isExactCover);
+        return 0;
+    }
+    for (int i = optind; i < argc; i++) {
+        FILE *input = fopen(argv[i], "r");
+        if (input == NULL) {
+            perror(argv[i]);
+            return 1;
+        }
+        solveFile(input, stdout, isExactCover);
+        fclose(input);
+    }
+    return 0;
+}
@@ -0,0 +1,320 @@
+//
+//  main.c
+//  Sudoku++
+//
+//  Created by Maarut Chandegra on 17/10/2026.
+//  Copyright © 2026 Maarut Chandegra. All rights reserved.
+//
+
+// Times the engine over fixed corpora of puzzles, one puzzle at a time so each solve has the whole task pool to
+// itself. For each corpus it reports solves per second, the median and 99th percentile solve time, and the average
+// number of allocations and guesses per solve. -j writes one JSON object per corpus instead, for tracking results
+// from run to run. Puzzles are graded unless -x or -c asks for the exact cover solver or for counting solutions.
+
+#include "MCPuzzleFormat.h"
+#include "MCSudokuEngine.h"
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#pragma mark Allocation Counting
+
+// glibc lets malloc and friends be replaced outright, with the originals still reachable under __libc_ names.
+// Elsewhere allocations aren't counted.
+#ifdef __GLIBC__
+
+#define MCCountsAllocations 1
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t count, size_t size);
+extern void *__libc_realloc(void *pointer, size_t size);
+
+static atomic_ulong allocationCount;
+
+void *malloc(size_t size)
+{
+    atomic_fetch_add_explicit(&allocationCount, 1, memory_order_relaxed);
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size)
+{
+    atomic_fetch_add_explicit(&allocationCount, 1, memory_order_relaxed);
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *pointer, size_t size)
+{
+    atomic_fetch_add_explicit(&allocationCount, 1, memory_order_relaxed);
+    return __libc_realloc(pointer, size);
+}
+
+static unsigned long allocations(void)
+{
+    return atomic_load_explicit(&allocationCount, memory_order_relaxed);
+}
+
+#else
+
+#define MCCountsAllocations 0
+
+static unsigned long allocations(void)
+{
+    return 0;
+}
+
+#endif
+
+#pragma mark Typedefs
+
+typedef enum _MCSolveMode {
+    MCSolveModeGraded,
+    MCSolveModeExactCover,
+    MCSolveModeCount
+} MCSolveMode;
+
+typedef struct _MCCorpus {
+    char *name;
+    uint order;
+    uint cellCount;
+    uint puzzleCount;
+    uint *problems;     // problems[puzzleCount * cellCount]
+} MCCorpus;
+
+typedef struct _MCBenchmarkResult {
+    uint solveCount;
+    uint notUniqueCount;
+    double seconds;
+    double solvesPerSecond;
+    double p50Microseconds;
+    double p99Microseconds;
+    double allocationsPerSolve;
+    double guessesPerSolve;
+} MCBenchmarkResult;
+
+#pragma mark Corpora
+
+static char *corpusName(const char *path)
+{
+    const char *start = strrchr(path, '/');
+    start = start != NULL ? start + 1 : path;
+    const char *end = strrchr(start, '.');
+    size_t length = end != NULL ? (size_t)(end - start) : strlen(start);
+    char *name = malloc(length + 1);
+    memcpy(name, start, length);
+    name[length] = '\0';
+    return name;
+}
+
+// Every puzzle in a corpus must be the same order. Blank lines and lines starting with '#' are skipped.
+static int loadCorpus(const char *path, MCCorpus *corpus)
+{
+    FILE *input = fopen(path, "r");
+    if (input == NULL) {
+        perror(path);
+        return 0;
+    }
+    corpus->name = corpusName(path);
+    corpus->order = 0;
+    corpus->cellCount = 0;
+    corpus->puzzleCount = 0;
+    corpus->problems = NULL;
+
+    int isLoaded = 1;
+    uint capacity = 0;
+    unsigned long lineNumber = 0;
+    char *text = NULL;
+    size_t textCapacity = 0;
+    ssize_t length;
+    while (isLoaded && (length = getline(&text, &textCapacity, input)) != -1) {
+        lineNumber++;
+        while (length > 0 && (text[length - 1] == '\n' || text[length - 1] == '\r')) { text[--length] = '\0'; }
+        if (length == 0 || text[0] == '#') { continue; }
+
+        uint order = orderForPuzzleLength(length);
+        if (order == 0 || (corpus->order != 0 && order != corpus->order)) {
+            fprintf(stderr, "%s:%lu: not a puzzle of the same order as the rest\n", path, lineNumber);
+            isLoaded = 0;
+            break;
+        }
+        if (corpus->order == 0) {
+            corpus->order = order;
+            corpus->cellCount = (uint)length;
+        }
+        if (corpus->puzzleCount == capacity) {
+            capacity = capacity == 0 ? 64 : capacity * 2;
+            corpus->problems = realloc(corpus->problems, sizeof(uint) * corpus->cellCount * capacity);
+        }
+        uint *problem = corpus->problems + corpus->puzzleCount * corpus->cellCount;
+        if (readPuzzle(text, order * order, corpus->cellCount, problem) != corpus->cellCount) {
+            fprintf(stderr, "%s:%lu: not a puzzle\n", path, lineNumber);
+            isLoaded = 0;
+            break;
+        }
+        corpus->puzzleCount++;
+    }
+    free(text);
+    fclose(input);
+    if (isLoaded && corpus->puzzleCount == 0) {
+        fprintf(stderr, "%s: no puzzles\n", path);
+        isLoaded = 0;
+    }
+    if (!isLoaded) {
+        free(corpus->name);
+        free(corpus->problems);
+    }
+    return isLoaded;
+}
+
+#pragma mark Timing
+
+static double now(void)
+{
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+static int compareDoubles(const void *lhs, const void *rhs)
+{
+    double a = *(const double *)lhs, b = *(const double *)rhs;
+    return (a > b) - (a < b);
+}
+
+static double percentile(const double *sorted, uint count, double fraction)
+{
+    uint index = (uint)(fraction * (count - 1) + 0.5);
+    return sorted[index < count ? index : count - 1];
+}
+
+// Returns whether the puzzle has a unique solution.
+static int solve(MCSudokuSolveContext *context, MCSolveMode mode)
+{
+    switch (mode) {
+        case MCSolveModeExactCover: return solveContextExactCover(context);
+        case MCSolveModeCount:      return countSolutions(context, 2) == 1;
+        case MCSolveModeGraded:
+        default:                    return solveContext(context);
+    }
+}
+
+static MCBenchmarkResult runCorpus(const MCCorpus *corpus, uint repeats, MCSolveMode mode)
+{
+    MCBenchmarkResult result = { 0 };
+    MCSudokuSolveContext *context = createContext(corpus->order);
+    size_t puzzleSize = sizeof(uint) * corpus->cellCount;
+
+    // One untimed solve so the task pool and topology are set up before the clock starts.
+    memcpy(context->problem, corpus->problems, puzzleSize);
+    solve(context, mode);
+
+    result.solveCount = corpus->puzzleCount * repeats;
+    double *latencies = malloc(sizeof(double) * result.solveCount);
+    unsigned long allocationTotal = 0, guessTotal = 0;
+    for (uint i = 0; i < result.solveCount; i++) {
+        memcpy(context->problem, corpus->problems + (i % corpus->puzzleCount) * corpus->cellCount, puzzleSize);
+        unsigned long allocationsBefore = allocations();
+        double start = now();
+        int isUnique = solve(context, mode);
+        latencies[i] = now() - start;
+        allocationTotal += allocations() - allocationsBefore;
+        guessTotal += context->guessCount;
+        result.seconds += latencies[i];
+        result.notUniqueCount += !isUnique;
+    }
+    destroyContext(context);
+
+    qsort(latencies, result.solveCount, sizeof(double), compareDoubles);
+    result.solvesPerSecond = result.solveCount / result.seconds;
+    result.p50Microseconds = percentile(latencies, result.solveCount, 0.5) * 1e6;
+    result.p99Microseconds = percentile(latencies, result.solveCount, 0.99) * 1e6;
+    result.allocationsPerSolve = MCCountsAllocations ? (double)allocationTotal / result.solveCount : -1;
+    result.guessesPerSolve = (double)guessTotal / result.solveCount;
+    free(latencies);
+    return result;
+}
+
+#pragma mark Reporting
+
+static void printResult(const MCCorpus *corpus, const MCBenchmarkResult *result, const char *mode, int isJSON)
+{
+    if (isJSON) {
+        printf("{\"corpus\":\"%s\",\"mode\":\"%s\",\"order\":%u,\"puzzles\":%u,\"solves\":%u,\"notUnique\":%u,"
+            "\"seconds\":%.6f,\"solvesPerSecond\":%.1f,\"p50Microseconds\":%.1f,\"p99Microseconds\":%.1f,"
+            "\"allocationsPerSolve\":%.1f,\"guessesPerSolve\":%.2f}\n",
+            corpus->name, mode, corpus->order, corpus->puzzleCount, result->solveCount, result->notUniqueCount,
+            result->seconds, result->solvesPerSecond, result->p50Microseconds, result->p99Microseconds,
+            result->allocationsPerSolve, result->guessesPerSolve);
+        return;
+    }
+    printf("%-12s %-7s %8u %12.1f %10.1f %10.1f %12.1f %10.2f\n", corpus->name, mode, result->solveCount,
+        result->solvesPerSecond, result->p50Microseconds, result->p99Microseconds, result->allocationsPerSolve,
+        result->guessesPerSolve);
+    if (result->notUniqueCount > 0) {
+        fprintf(stderr, "%s: %u solves didn't find a unique solution\n", corpus->name, result->notUniqueCount);
+    }
+}
+
+#pragma mark Main
+
+static void printUsage(const char *name)
+{
+    fprintf(stderr, "Usage: %s [-x | -c] [-j] [-r repeats] corpus ...\n", name);
+    fprintf(stderr, "  -x  Solve with the exact cover solver instead of grading\n");
+    fprintf(stderr, "  -c  Count solutions, up to 2, instead of grading\n");
+    fprintf(stderr, "  -j  Write results as JSON, one object per line\n");
+    fprintf(stderr, "  -r  Solve every puzzle this many times (default 3)\n");
+}
+
+int main(int argc, char *argv[])
+{
+    MCSolveMode mode = MCSolveModeGraded;
+    int isJSON = 0, option;
+    uint repeats = 3;
+    while ((option = getopt(argc, argv, "xcjr:h")) != -1) {
+        switch (option) {
+            case 'x':
+                mode = MCSolveModeExactCover;
+                break;
+            case 'c':
+                mode = MCSolveModeCount;
+                break;
+            case 'j':
+                isJSON = 1;
+                break;
+            case 'r':
+                repeats = (uint)strtoul(optarg, NULL, 10);
+                if (repeats == 0) {
+                    printUsage(argv[0]);
+                    return 1;
+                }
+                break;
+            default:
+                printUsage(argv[0]);
+                return option == 'h' ? 0 : 1;
+        }
+    }
+    if (optind == argc) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    const char *modeNames[] = { "graded", "exact", "count" };
+    if (!isJSON) {
+        printf("%-12s %-7s %8s %12s %10s %10s %12s %10s\n", "corpus", "mode", "solves", "solves/s", "p50 us",
+            "p99 us", "allocs/solve", "guesses");
+    }
+    for (int i = optind; i < argc; i++) {
+        MCCorpus corpus;
+        if (!loadCorpus(argv[i], &corpus)) { return 1; }
+        MCBenchmarkResult result = runCorpus(&corpus, repeats, mode);
+        printResult(&corpus, &result, modeNames[mode], isJSON);
+        fflush(stdout);
+        free(corpus.name);
+        free(corpus.problems);
+    }
+    return 0;
+}
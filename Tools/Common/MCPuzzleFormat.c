@@ -0,0 +1,49 @@
+//
+//  MCPuzzleFormat.c
+//  Sudoku++
+//
+//  Created by Maarut Chandegra on 17/10/2026.
+//  Copyright © 2026 Maarut Chandegra. All rights reserved.
+//
+
+#include "MCPuzzleFormat.h"
+#include <stdint.h>
+
+static uint numberForCharacter(char character)
+{
+    if (character == '.' || character == '0') { return 0; }
+    if (character >= '1' && character <= '9') { return character - '0'; }
+    if (character >= 'A' && character <= 'Z') { return character - 'A' + 10; }
+    if (character >= 'a' && character <= 'z') { return character - 'a' + 10; }
+    return UINT32_MAX;
+}
+
+static char characterForNumber(uint number)
+{
+    if (number == 0) { return '.'; }
+    return number < 10 ? '0' + number : 'A' + (number - 10);
+}
+
+uint orderForPuzzleLength(size_t length)
+{
+    for (uint order = 2; order <= MCPuzzleFormatMaxOrder; order++) {
+        if (length == order * order * order * order) { return order; }
+    }
+    return 0;
+}
+
+uint readPuzzle(const char *text, uint dimensionality, uint cellCount, uint *problem)
+{
+    for (uint i = 0; i < cellCount; i++) {
+        uint number = numberForCharacter(text[i]);
+        if (number > dimensionality) { return i; }
+        problem[i] = number;
+    }
+    return cellCount;
+}
+
+void writePuzzle(const uint *numbers, uint cellCount, char *text)
+{
+    for (uint i = 0; i < cellCount; i++) { text[i] = characterForNumber(numbers[i]); }
+    text[cellCount] = '\0';
+}
@@ -0,0 +1,30 @@
+//
+//  MCPuzzleFormat.h
+//  Sudoku++
+//
+//  Created by Maarut Chandegra on 17/10/2026.
+//  Copyright © 2026 Maarut Chandegra. All rights reserved.
+//
+
+#ifndef MCPuzzleFormat_h
+#define MCPuzzleFormat_h
+
+#include <stddef.h>
+#include <sys/types.h>
+
+// Puzzles are written on one line, dimensionality^2 characters long, reading across each row in turn. Blank cells are
+// '.' or '0', 1 to 9 are themselves and 10 onwards are 'A', 'B' and so on, as in SudokuBoard's description.
+
+#define MCPuzzleFormatMaxOrder 5
+
+// The order of a puzzle line of the given length, or 0 if it isn't a puzzle.
+uint orderForPuzzleLength(size_t length);
+
+// Reads cellCount characters of text into problem. Returns cellCount, or the index of the first character that isn't
+// a number from 0 to dimensionality.
+uint readPuzzle(const char *text, uint dimensionality, uint cellCount, uint *problem);
+
+// Writes cellCount numbers to text, followed by a terminating '\0'.
+void writePuzzle(const uint *numbers, uint cellCount, char *text);
+
+#endif /* MCPuzzleFormat_h */
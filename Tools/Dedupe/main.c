@@ -0,0 +1,135 @@
+//
+//  main.c
+//  Sudoku++
+//
+//  Created by Maarut Chandegra on 17/10/2026.
+//  Copyright © 2026 Maarut Chandegra. All rights reserved.
+//
+
+// Copies puzzles read one per line, either from the files named on the command line or from standard input, to
+// standard output, leaving out any that are a symmetry of one already written: the same puzzle with its numbers
+// relabelled, its rows or columns reordered within their bands and stacks, its bands or stacks reordered, or
+// reflected about the main diagonal. -c writes each puzzle's canonical form in its place, as described in
+// MCCanonicalForm.h. Puzzles are in the format described in MCPuzzleFormat.h, and anything after the puzzle on its
+// line, following a tab, is copied along with it. Blank lines and lines starting with '#' are copied as they are.
+// Puzzles with too few clues for their canonical form to be found are reported and left out.
+
+#include "MCCanonicalForm.h"
+#include "MCPuzzleFormat.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#pragma mark Typedefs
+
+typedef struct _MCDedupe {
+    MCPuzzleSet *sets[MCPuzzleFormatMaxOrder + 1];
+    uint *puzzle;
+    uint *canonical;
+    char *text;
+    int isCanonical;
+    unsigned long readCount;
+    unsigned long writtenCount;
+} MCDedupe;
+
+#pragma mark Deduplicating
+
+static void dedupeLine(MCDedupe *dedupe, const char *name, unsigned long lineNumber, const char *line,
+    size_t length, FILE *output)
+{
+    size_t puzzleLength = strcspn(line, "\t");
+    uint order = orderForPuzzleLength(puzzleLength);
+    if (order == 0) {
+        fprintf(stderr, "%s:%lu: %zu characters isn't a puzzle\n", name, lineNumber, puzzleLength);
+        return;
+    }
+    uint dimensionality = order * order, cellCount = dimensionality * dimensionality;
+    uint badIndex = readPuzzle(line, dimensionality, cellCount, dedupe->puzzle);
+    if (badIndex < cellCount) {
+        fprintf(stderr, "%s:%lu: unexpected '%c'\n", name, lineNumber, line[badIndex]);
+        return;
+    }
+
+    if (dedupe->sets[order] == NULL) { dedupe->sets[order] = createPuzzleSet(order); }
+    int isAdded = addPuzzleToSet(dedupe->sets[order], dedupe->puzzle);
+    if (isAdded < 0) {
+        fprintf(stderr, "%s:%lu: too few clues to find its canonical form\n", name, lineNumber);
+        return;
+    }
+    dedupe->readCount++;
+    if (!isAdded) { return; }
+    dedupe->writtenCount++;
+    if (dedupe->isCanonical) {
+        canonicalizeGrid(order, dedupe->puzzle, dedupe->canonical, NULL);
+        writePuzzle(dedupe->canonical, cellCount, dedupe->text);
+        fprintf(output, "%s%.*s\n", dedupe->text, (int)(length - puzzleLength), line + puzzleLength);
+    }
+    else {
+        fprintf(output, "%.*s\n", (int)length, line);
+    }
+}
+
+static void dedupeFile(MCDedupe *dedupe, const char *name, FILE *input, FILE *output)
+{
+    unsigned long lineNumber = 0;
+    char *line = NULL;
+    size_t capacity = 0;
+    ssize_t length;
+    while ((length = getline(&line, &capacity, input)) != -1) {
+        lineNumber++;
+        while (length > 0 && (line[length - 1] == '\n' || line[length - 1] == '\r')) { line[--length] = '\0'; }
+        if (length == 0 || line[0] == '#') { fprintf(output, "%s\n", line); }
+        else { dedupeLine(dedupe, name, lineNumber, line, length, output); }
+    }
+    free(line);
+}
+
+#pragma mark Main
+
+static void printUsage(const char *name)
+{
+    fprintf(stderr, "Usage: %s [-c] [file ...]\n", name);
+    fprintf(stderr, "  -c  Write each puzzle's canonical form instead of the puzzle itself\n");
+}
+
+int main(int argc, char *argv[])
+{
+    MCDedupe dedupe = { .isCanonical = 0 };
+    int option;
+    while ((option = getopt(argc, argv, "ch")) != -1) {
+        switch (option) {
+            case 'c':
+                dedupe.isCanonical = 1;
+                break;
+            default:
+                printUsage(argv[0]);
+                return option == 'h' ? 0 : 1;
+        }
+    }
+
+    uint maxCellCount = MCPuzzleFormatMaxOrder * MCPuzzleFormatMaxOrder * MCPuzzleFormatMaxOrder *
+        MCPuzzleFormatMaxOrder;
+    dedupe.puzzle = malloc(sizeof(uint) * maxCellCount * 2);
+    dedupe.canonical = dedupe.puzzle + maxCellCount;
+    dedupe.text = malloc(maxCellCount + 1);
+    int status = 0;
+    if (optind == argc) { dedupeFile(&dedupe, "<stdin>", stdin, stdout); }
+    for (int i = optind; i < argc && status == 0; i++) {
+        FILE *input = fopen(argv[i], "r");
+        if (input == NULL) {
+            perror(argv[i]);
+            status = 1;
+            continue;
+        }
+        dedupeFile(&dedupe, argv[i], input, stdout);
+        fclose(input);
+    }
+    fprintf(stderr, "%lu of %lu puzzles were symmetries of others\n", dedupe.readCount - dedupe.writtenCount,
+        dedupe.readCount);
+
+    for (uint order = 0; order <= MCPuzzleFormatMaxOrder; order++) { destroyPuzzleSet(dedupe.sets[order]); }
+    free(dedupe.puzzle);
+    free(dedupe.text);
+    return status;
+}
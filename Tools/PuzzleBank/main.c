@@ -0,0 +1,127 @@
+//
+//  main.c
+//  Sudoku++
+//
+//  Created by Maarut Chandegra on 17/10/2026.
+//  Copyright © 2026 Maarut Chandegra. All rights reserved.
+//
+
+// Generates puzzles of every difficulty and writes them to a bank, as described in MCPuzzleBank.h, for the app to
+// hand out without generating anything itself. Puzzles are filed under the difficulty they were graded as, which
+// isn't always the one asked for, and any that are a symmetry of one already in the bank are left out. Each puzzle
+// uses the next seed along, so the same options always write the same bank.
+
+#include "MCCanonicalForm.h"
+#include "MCPuzzleBank.h"
+#include "MCPuzzleFormat.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+// Generating stops short of a difficulty's count after this many tries per puzzle, as some orders rarely if ever
+// grade as insane.
+#define MCAttemptsPerPuzzle 8
+
+#pragma mark Typedefs
+
+static const MCPuzzleDifficulty difficulties[] = {
+    MCPuzzleDifficultyEasy, MCPuzzleDifficultyNormal, MCPuzzleDifficultyHard, MCPuzzleDifficultyInsane
+};
+static const char *difficultyNames[] = { "easy", "normal", "hard", "insane" };
+#define MCDifficultyCount (sizeof(difficulties) / sizeof(difficulties[0]))
+
+typedef struct _MCBankOptions {
+    uint orders[MCPuzzleFormatMaxOrder + 1];
+    uint orderCount;
+    uint count;
+    uint64_t seed;
+} MCBankOptions;
+
+#pragma mark Generating
+
+static int indexOfDifficulty(MCPuzzleDifficulty difficulty)
+{
+    for (uint i = 0; i < MCDifficultyCount; i++) {
+        if (difficulties[i] == difficulty) { return i; }
+    }
+    return -1;
+}
+
+// Puzzles asked for at one difficulty that come out at another still fill that one, if it isn't full already.
+static void generateOrder(MCPuzzleBankBuilder *builder, uint order, uint count, uint64_t *seed)
+{
+    MCPuzzleSet *set = createPuzzleSet(order);
+    uint counts[MCDifficultyCount] = { 0 };
+    for (uint i = 0; i < MCDifficultyCount; i++) {
+        time_t start = time(NULL);
+        for (uint attempt = 0; attempt < count * MCAttemptsPerPuzzle && counts[i] < count; attempt++) {
+            MCSudokuSolveContext *puzzle = generatePuzzleWithOrder(order, difficulties[i], (*seed)++);
+            int index = indexOfDifficulty(puzzle->difficulty);
+            if (index >= 0 && counts[index] < count && addPuzzleToSet(set, puzzle->problem) > 0 &&
+                addPuzzleToBank(builder, puzzle)) {
+                counts[index]++;
+            }
+            destroyContext(puzzle);
+        }
+        fprintf(stderr, "Order %u %s: %u of %u puzzles in %lds\n", order, difficultyNames[i], counts[i], count,
+            (long)(time(NULL) - start));
+    }
+    destroyPuzzleSet(set);
+}
+
+#pragma mark Main
+
+static void printUsage(const char *name)
+{
+    fprintf(stderr, "Usage: %s [-r order] [-n count] [-s seed] file\n", name);
+    fprintf(stderr, "  -r order  Generate puzzles of this order, 3 unless given; repeat for more than one\n");
+    fprintf(stderr, "  -n count  Puzzles of each difficulty, 100 unless given\n");
+    fprintf(stderr, "  -s seed   The seed of the first puzzle, 1 unless given\n");
+}
+
+int main(int argc, char *argv[])
+{
+    MCBankOptions options = { .orderCount = 0, .count = 100, .seed = 1 };
+    int option;
+    while ((option = getopt(argc, argv, "r:n:s:h")) != -1) {
+        switch (option) {
+            case 'r':
+            {
+                uint order = (uint)strtoul(optarg, NULL, 10);
+                if (order < 2 || order > MCPuzzleFormatMaxOrder || options.orderCount > MCPuzzleFormatMaxOrder) {
+                    fprintf(stderr, "%s: orders go from 2 to %d\n", optarg, MCPuzzleFormatMaxOrder);
+                    return 1;
+                }
+                options.orders[options.orderCount++] = order;
+                break;
+            }
+            case 'n':
+                options.count = (uint)strtoul(optarg, NULL, 10);
+                break;
+            case 's':
+                options.seed = strtoull(optarg, NULL, 10);
+                break;
+            default:
+                printUsage(argv[0]);
+                return option == 'h' ? 0 : 1;
+        }
+    }
+    if (optind != argc - 1) {
+        printUsage(argv[0]);
+        return 1;
+    }
+    if (options.orderCount == 0) { options.orders[options.orderCount++] = 3; }
+
+    MCPuzzleBankBuilder *builder = createPuzzleBankBuilder();
+    uint64_t seed = options.seed;
+    for (uint i = 0; i < options.orderCount; i++) { generateOrder(builder, options.orders[i], options.count, &seed); }
+    int isWritten = writePuzzleBank(builder, argv[optind]);
+    destroyPuzzleBankBuilder(builder);
+    if (!isWritten) {
+        perror(argv[optind]);
+        return 1;
+    }
+    return 0;
+}